@@ -0,0 +1,170 @@
+
+/**
+ * PyOtherSide: Asynchronous Python 3 Bindings for Qt 5 and Qt 6
+ * Copyright (c) 2025, Thomas Perl <m@thp.io>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ **/
+
+/**
+ * Measures interpreter startup time for the PYOTHERSIDE_* startup options.
+ *
+ * Each profile is run several times in a fresh process (Python can only be
+ * initialized once per process); the child reports how long it took until
+ * the first Python object could evaluate an expression. The qrc profiles
+ * also import a module from Qt Resources (the qrc importer itself), with an
+ * empty ("cold") and a populated ("warm") bytecode cache.
+ *
+ * Usage: startup [--runs N] [--importtime]
+ **/
+
+#include "qpython.h"
+
+#include <QCoreApplication>
+#include <QProcess>
+#include <QProcessEnvironment>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QTextStream>
+#include <QTemporaryDir>
+
+#include <algorithm>
+
+enum StartupCache {
+    NoImport,
+    ColdCache,
+    WarmCache,
+};
+
+struct StartupProfile {
+    const char *name;
+    const char *environment;
+    StartupCache cache;
+};
+
+static const StartupProfile profiles[] = {
+    { "default", "", NoImport },
+    { "no-site", "PYOTHERSIDE_NO_SITE=1", NoImport },
+    { "isolated", "PYOTHERSIDE_ISOLATED=1", NoImport },
+    { "isolated-no-site", "PYOTHERSIDE_ISOLATED=1 PYOTHERSIDE_NO_SITE=1 "
+        "PYOTHERSIDE_DONT_WRITE_BYTECODE=1", NoImport },
+#if PY_VERSION_HEX >= 0x030B0000
+    { "frozen", "PYOTHERSIDE_ISOLATED=1 PYOTHERSIDE_NO_SITE=1 "
+        "PYOTHERSIDE_DONT_WRITE_BYTECODE=1 PYOTHERSIDE_FROZEN_MODULES=1", NoImport },
+#endif
+    { "qrc-cold", "", ColdCache },
+    { "qrc-warm", "", WarmCache },
+};
+
+static int
+run_child(bool qrc)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QPython16 py;
+    QVariant result = py.evaluate("1 + 1");
+    if (qrc) {
+        py.addImportPath("qrc:/io/thp/pyotherside");
+        if (!py.importModule_sync("qrc_importer")) {
+            return 1;
+        }
+    }
+
+    qint64 elapsed = timer.nsecsElapsed();
+    if (result.toInt() != 2) {
+        return 1;
+    }
+
+    QTextStream(stdout) << elapsed << "\n";
+    return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments();
+
+    if (args.contains("--child")) {
+        return run_child(args.contains("--qrc"));
+    }
+
+    int runs = 10;
+    int runs_index = args.indexOf("--runs");
+    if (runs_index != -1 && runs_index + 1 < args.size()) {
+        runs = qMax(1, args[runs_index + 1].toInt());
+    }
+    bool importtime = args.contains("--importtime");
+
+    QTextStream out(stdout);
+    out << "profile              min [ms]  median [ms]\n";
+
+    for (size_t i=0; i<sizeof(profiles)/sizeof(profiles[0]); i++) {
+        QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+        QStringList settings = QString(profiles[i].environment).split(' ');
+        for (int j=0; j<settings.size(); j++) {
+            int eq = settings[j].indexOf('=');
+            if (eq != -1) {
+                env.insert(settings[j].left(eq), settings[j].mid(eq + 1));
+            }
+        }
+        if (importtime) {
+            env.insert("PYOTHERSIDE_IMPORTTIME", "1");
+        }
+
+        // The bytecode cache is in $XDG_CACHE_HOME (on Linux)
+        QTemporaryDir cache_home;
+        env.insert("XDG_CACHE_HOME", cache_home.path());
+
+        QStringList child_args;
+        child_args << "--child";
+        if (profiles[i].cache != NoImport) {
+            child_args << "--qrc";
+        }
+
+        QList<qint64> timings;
+        for (int run=(profiles[i].cache == WarmCache) ? -1 : 0; run<runs; run++) {
+            QTemporaryDir cold_cache_home;
+            if (profiles[i].cache == ColdCache) {
+                env.insert("XDG_CACHE_HOME", cold_cache_home.path());
+            }
+
+            QProcess child;
+            child.setProcessEnvironment(env);
+            if (importtime && run == 0) {
+                // Show the -X importtime report of the first run only
+                child.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+            }
+            child.start(app.applicationFilePath(), child_args);
+            if (!child.waitForFinished(-1) || child.exitCode() != 0) {
+                qWarning("Profile %s failed", profiles[i].name);
+                return 1;
+            }
+
+            // Run -1 only populates the cache for the warm profile
+            if (run >= 0) {
+                timings << child.readAllStandardOutput().trimmed().toLongLong();
+            }
+        }
+
+        std::sort(timings.begin(), timings.end());
+        out << QString(profiles[i].name).leftJustified(20)
+            << QString::number(timings.first() / 1e6, 'f', 2).rightJustified(9)
+            << QString::number(timings[timings.size() / 2] / 1e6, 'f', 2).rightJustified(13)
+            << "\n";
+        out.flush();
+    }
+
+    return 0;
+}
@@ -0,0 +1,38 @@
+QT += qml
+CONFIG -= app_bundle
+
+TARGET = startup
+
+include(../pyotherside.pri)
+DEFINES += PYOTHERSIDE_VERSION=\\\"$${VERSION}\\\"
+
+SOURCES += startup.cpp
+
+# Module imported from Qt Resources by the qrc profiles
+RESOURCES += ../src/qrc_importer.qrc
+
+SOURCES += ../src/qpython.cpp
+SOURCES += ../src/qpython_worker.cpp
+SOURCES += ../src/qpython_asynciowatcher.cpp
+SOURCES += ../src/qpython_priv.cpp
+SOURCES += ../src/qpython_framestream.cpp
+SOURCES += ../src/qpython_callable.cpp
+SOURCES += ../src/pyobject_ref.cpp
+SOURCES += ../src/qobject_ref.cpp
+
+HEADERS += ../src/qpython.h
+HEADERS += ../src/qpython_worker.h
+HEADERS += ../src/qpython_asynciowatcher.h
+HEADERS += ../src/qpython_priv.h
+HEADERS += ../src/qpython_framestream.h
+HEADERS += ../src/qpython_callable.h
+HEADERS += ../src/converter.h
+HEADERS += ../src/qvariant_converter.h
+HEADERS += ../src/pyobject_converter.h
+HEADERS += ../src/pyobject_ref.h
+HEADERS += ../src/qobject_ref.h
+
+DEPENDPATH += . ../src
+INCLUDEPATH += . ../src
+
+include(../python.pri)
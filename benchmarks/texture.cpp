@@ -0,0 +1,209 @@
+/**
+ * PyOtherSide: Asynchronous Python 3 Bindings for Qt 5 and Qt 6
+ * Copyright (c) 2025, Thomas Perl <m@thp.io>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ **/
+
+/**
+ * Drives QQuickTextureFactory::createTexture() under a real scene graph (a
+ * QQuickWindow, on the render thread with its context current) for frames
+ * from image://python/ (the QImage goes through
+ * QQuickTextureFactory::textureFactoryForImage()) and image://python-texture/
+ * (QPythonTextureFactory), and measures the time per frame spent creating
+ * and uploading the texture.
+ *
+ * For image://python-texture/, it also counts how the frames were uploaded
+ * (see QPythonTextureStats): straight from the Python buffer (and of those,
+ * with GL_UNPACK_ROW_LENGTH or row by row), with the pool's texture storage
+ * reused or allocated, or through the scene graph's createTextureFromImage()
+ * fallback, which copies the pixels (always the case with Qt 6, where the
+ * upload itself also only happens when the frame is rendered).
+ *
+ * Run with QT_QPA_PLATFORM=offscreen if there is no display.
+ *
+ * Usage: texture [--frames N] [--size WxH]
+ **/
+
+#include "qpython.h"
+#include "qpython_imageprovider.h"
+#include "qpython_texturefactory.h"
+
+#include <QGuiApplication>
+#include <QQuickWindow>
+#include <QQuickItem>
+#include <QSGSimpleTextureNode>
+#include <QSurfaceFormat>
+#include <QEventLoop>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QTextStream>
+
+struct TextureProfile {
+    const char *format;
+    int padding;
+};
+
+static const TextureProfile profiles[] = {
+    { "argb32_premultiplied", 0 },
+    { "argb32_premultiplied", 64 },
+    { "rgb32", 0 },
+    { "rgba8888_premultiplied", 0 },
+    { "rgbx8888", 0 },
+    { "rgb888", 0 },
+    { "argb32", 0 },
+};
+
+// Creates a texture from the factory set on the GUI thread once per frame
+class TextureItem : public QQuickItem {
+public:
+    TextureItem()
+        : QQuickItem()
+        , factory(NULL)
+        , nsecs(0)
+    {
+        setFlag(ItemHasContents, true);
+    }
+
+    // Only accessed while the GUI thread is blocked or idle between frames
+    QQuickTextureFactory *factory;
+    qint64 nsecs;
+
+protected:
+    virtual QSGNode *updatePaintNode(QSGNode *old, UpdatePaintNodeData *)
+    {
+        QSGSimpleTextureNode *node = static_cast<QSGSimpleTextureNode *>(old);
+        if (!node) {
+            node = new QSGSimpleTextureNode;
+        }
+
+        if (factory) {
+            QElapsedTimer timer;
+            timer.start();
+
+            QSGTexture *texture = factory->createTexture(window());
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+            // Upload now instead of when the node is rendered
+            texture->bind();
+#endif
+            // Releases the previous frame's texture into the pool
+            QSGTexture *previous = node->texture();
+            node->setTexture(texture);
+            delete previous;
+
+            nsecs += timer.nsecsElapsed();
+
+            delete factory;
+            factory = NULL;
+        }
+
+        node->setRect(boundingRect());
+        return node;
+    }
+};
+
+static void
+render_frame(QQuickWindow *window, TextureItem *item, QQuickTextureFactory *factory)
+{
+    item->factory = factory;
+    item->update();
+
+    QEventLoop loop;
+    QObject::connect(window, SIGNAL(frameSwapped()), &loop, SLOT(quit()));
+    loop.exec();
+}
+
+int
+main(int argc, char *argv[])
+{
+    // Don't wait for vsync, only the texture uploads should be measured
+    QSurfaceFormat format = QSurfaceFormat::defaultFormat();
+    format.setSwapInterval(0);
+    QSurfaceFormat::setDefaultFormat(format);
+
+    QGuiApplication app(argc, argv);
+    QStringList args = app.arguments();
+
+    int frames = 1000;
+    int frames_index = args.indexOf("--frames");
+    if (frames_index != -1 && frames_index + 1 < args.size()) {
+        frames = qMax(1, args[frames_index + 1].toInt());
+    }
+
+    QString size = "1920x1080";
+    int size_index = args.indexOf("--size");
+    if (size_index != -1 && size_index + 1 < args.size()) {
+        size = args[size_index + 1];
+    }
+
+    QPython16 py;
+    py.addImportPath(BENCHMARKS_SRCDIR);
+    if (!py.importModule_sync("texture_frames")) {
+        return 1;
+    }
+
+    QPythonImageProvider provider;
+
+    QQuickWindow window;
+    window.resize(640, 360);
+    TextureItem *item = new TextureItem;
+    item->setParentItem(window.contentItem());
+    item->setSize(QSizeF(640, 360));
+    window.show();
+
+    QTextStream out(stdout);
+    out << "format                   padding  image [us]  texture [us]"
+        "  uploads  strided  row by row  pool hits  pool misses  fallbacks\n";
+
+    for (size_t i=0; i<sizeof(profiles)/sizeof(profiles[0]); i++) {
+        QString id = QString("%1/%2/%3").arg(profiles[i].format).arg(size).arg(profiles[i].padding);
+        QSize image_size;
+
+        // Warm up, so that the pool has texture storage for this size
+        render_frame(&window, item, provider.requestTexture(id, &image_size, QSize()));
+
+        item->nsecs = 0;
+        for (int frame=0; frame<frames; frame++) {
+            QImage image = provider.requestImage(id, &image_size, QSize());
+            if (image.isNull()) {
+                qWarning("Could not get frame %s", qPrintable(id));
+                return 1;
+            }
+            render_frame(&window, item, QQuickTextureFactory::textureFactoryForImage(image));
+        }
+        qint64 image_elapsed = item->nsecs;
+
+        QPythonTextureFactory::resetStats();
+        item->nsecs = 0;
+        for (int frame=0; frame<frames; frame++) {
+            render_frame(&window, item, provider.requestTexture(id, &image_size, QSize()));
+        }
+        qint64 texture_elapsed = item->nsecs;
+        QPythonTextureStats stats = QPythonTextureFactory::stats();
+
+        out << QString(profiles[i].format).leftJustified(25)
+            << QString::number(profiles[i].padding).rightJustified(7)
+            << QString::number(image_elapsed / 1e3 / frames, 'f', 1).rightJustified(12)
+            << QString::number(texture_elapsed / 1e3 / frames, 'f', 1).rightJustified(14)
+            << QString::number(stats.uploads).rightJustified(9)
+            << QString::number(stats.strided).rightJustified(9)
+            << QString::number(stats.rowByRow).rightJustified(12)
+            << QString::number(stats.poolHits).rightJustified(11)
+            << QString::number(stats.poolMisses).rightJustified(13)
+            << QString::number(stats.fallbacks).rightJustified(11)
+            << "\n";
+        out.flush();
+    }
+
+    return 0;
+}
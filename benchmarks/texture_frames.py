@@ -0,0 +1,38 @@
+# Frames for the texture benchmark, served by the default image provider
+
+import array
+
+import pyotherside
+
+FORMATS = {
+    'argb32_premultiplied': (pyotherside.format_argb32_premultiplied, 4),
+    'rgb32': (pyotherside.format_rgb32, 4),
+    'rgba8888_premultiplied': (pyotherside.format_rgba8888_premultiplied, 4),
+    'rgbx8888': (pyotherside.format_rgbx8888, 4),
+    'rgb888': (pyotherside.format_rgb888, 3),
+    'argb32': (pyotherside.format_argb32, 4),
+}
+
+# The same buffer is served for every frame of a profile, like a video frame
+# that is updated in place
+frames = {}
+
+
+def frame(image_id):
+    # "<format>/<width>x<height>/<padding>"
+    name, size, padding = image_id.split('/')
+    width, height = (int(x) for x in size.split('x'))
+    format, bytes_per_pixel = FORMATS[name]
+    bytes_per_line = width * bytes_per_pixel + int(padding)
+
+    if image_id not in frames:
+        frames[image_id] = array.array('B', bytes(bytes_per_line * height))
+
+    return frames[image_id], (width, height), format, bytes_per_line
+
+
+def image_provider(image_id, requested_size):
+    return frame(image_id)
+
+
+pyotherside.set_image_provider(image_provider)
@@ -0,0 +1,9 @@
+import asyncio
+
+async def add_later(a, b):
+    await asyncio.sleep(0.05)
+    return a + b
+
+async def fail_later():
+    await asyncio.sleep(0.01)
+    raise ValueError('failed on purpose')
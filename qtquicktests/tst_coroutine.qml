@@ -0,0 +1,34 @@
+import QtQuick 2.0
+import io.thp.pyotherside 1.6
+import QtTest 1.2
+
+TestCase {
+    property var results: []
+    property string lastError: ''
+
+    Python {
+        id: py
+        Component.onCompleted: {
+            addImportPath(Qt.resolvedUrl('.'));
+            importModule_sync('tst_coroutine');
+        }
+        onError: lastError = traceback
+    }
+
+    function test_awaitable_result() {
+        results = [];
+        for (var i = 0; i < 10; i++) {
+            py.call('tst_coroutine.add_later', [i, 1], function (result) {
+                results.push(result);
+            });
+        }
+        tryCompare(results, 'length', 10);
+        compare(results.reduce(function (a, b) { return a + b; }, 0), 55);
+    }
+
+    function test_awaitable_error() {
+        lastError = '';
+        py.call('tst_coroutine.fail_later', []);
+        tryVerify(function () { return lastError.indexOf('failed on purpose') != -1; });
+    }
+}
@@ -0,0 +1,49 @@
+import pyotherside
+
+
+def commit(name, count):
+    for value in range(count):
+        frame = pyotherside.acquire_frame(name)
+        view = memoryview(frame)
+        view[:] = bytes([value]) * len(view)
+        view.release()
+        pyotherside.commit_frame(frame)
+
+
+def frame_info(name):
+    frame = pyotherside.acquire_frame(name)
+    if frame is None:
+        return None
+    return [list(frame.size), frame.bytes_per_line, frame.format, len(memoryview(frame))]
+
+
+def commit_twice(name):
+    frame = pyotherside.acquire_frame(name)
+    pyotherside.commit_frame(frame)
+    try:
+        pyotherside.commit_frame(frame)
+    except ValueError:
+        return True
+    return False
+
+
+def commit_with_view(name):
+    frame = pyotherside.acquire_frame(name)
+    view = memoryview(frame)
+    try:
+        pyotherside.commit_frame(frame)
+    except BufferError:
+        view.release()
+        pyotherside.commit_frame(frame)
+        return True
+    return False
+
+
+def acquire_all(name):
+    frames = []
+    try:
+        while len(frames) < 10:
+            frames.append(pyotherside.acquire_frame(name))
+    except RuntimeError:
+        return len(frames)
+    return -1
@@ -0,0 +1,62 @@
+import QtQuick 2.0
+import io.thp.pyotherside 1.6
+import QtTest 1.2
+
+TestCase {
+    when: windowShown
+
+    Python {
+        id: py
+        Component.onCompleted: {
+            addImportPath(Qt.resolvedUrl('.'));
+            importModule_sync('tst_frame_stream');
+        }
+    }
+
+    PyFrameStream {
+        id: stream
+        name: 'tst-stream'
+        frameSize: Qt.size(5, 3)
+    }
+
+    PyFrameStream {
+        id: idle
+        name: 'tst-idle'
+        frameSize: Qt.size(5, 3)
+        format: PyFrameStream.RGB888
+        bufferCount: 2
+    }
+
+    function test_frame_info() {
+        compare(py.call_sync('tst_frame_stream.frame_info', ['tst-missing']), null);
+        compare(py.call_sync('tst_frame_stream.frame_info', ['tst-stream']),
+                [[5, 3], 20, 6, 60]);
+        // Rows are 32-bit aligned
+        compare(py.call_sync('tst_frame_stream.frame_info', ['tst-idle']),
+                [[5, 3], 16, 13, 48]);
+        compare(stream.implicitWidth, 5);
+        compare(stream.implicitHeight, 3);
+    }
+
+    function test_present() {
+        var presented = stream.presentedFrames;
+        py.call_sync('tst_frame_stream.commit', ['tst-stream', 1]);
+        tryCompare(stream, 'presentedFrames', presented + 1);
+    }
+
+    function test_drop_stale_frames() {
+        var presented = stream.presentedFrames;
+        var dropped = stream.droppedFrames;
+
+        // Only the newest of these is shown
+        py.call_sync('tst_frame_stream.commit', ['tst-stream', 3]);
+        tryCompare(stream, 'presentedFrames', presented + 1);
+        compare(stream.droppedFrames, dropped + 2);
+    }
+
+    function test_errors() {
+        verify(py.call_sync('tst_frame_stream.commit_twice', ['tst-stream']));
+        verify(py.call_sync('tst_frame_stream.commit_with_view', ['tst-stream']));
+        compare(py.call_sync('tst_frame_stream.acquire_all', ['tst-idle']), 2);
+    }
+}
@@ -0,0 +1,18 @@
+import asyncio
+
+import pyotherside
+
+
+async def image_provider(image_id, requested_size):
+    if image_id == 'error':
+        raise ValueError('No such image')
+
+    # Other requests can run in the meantime
+    await asyncio.sleep(0.01)
+
+    width, height = 2, 3
+    pixels = bytearray(b'\x00\x00\xff\xff' * width * height)
+    return pixels, (width, height), pyotherside.format_argb32
+
+
+pyotherside.set_image_provider(image_provider)
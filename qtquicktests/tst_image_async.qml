@@ -0,0 +1,40 @@
+import QtQuick 2.0
+import io.thp.pyotherside 1.6
+import QtTest 1.2
+
+TestCase {
+    Python {
+        Component.onCompleted: {
+            addImportPath(Qt.resolvedUrl('.'));
+            importModule_sync('tst_image_async');
+        }
+    }
+
+    Repeater {
+        id: images
+        // Set in the test, once the image provider has been set
+        model: 0
+
+        Image {
+            source: 'image://python-async/image' + index
+        }
+    }
+
+    Image {
+        id: broken
+    }
+
+    function test_coroutine_provider() {
+        images.model = 5;
+        for (var i = 0; i < images.count; i++) {
+            tryCompare(images.itemAt(i), 'status', Image.Ready);
+            compare(images.itemAt(i).implicitWidth, 2);
+            compare(images.itemAt(i).implicitHeight, 3);
+        }
+    }
+
+    function test_provider_error() {
+        broken.source = 'image://python-async/error';
+        tryCompare(broken, 'status', Image.Error);
+    }
+}
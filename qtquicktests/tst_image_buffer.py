@@ -0,0 +1,37 @@
+import array
+import pyotherside
+
+
+def image_provider(image_id, requested_size):
+    width, height = 4, 4
+    pixels = b'\x00\xff\x00\xff' * width * height
+    if image_id == 'bytes':
+        return pixels, (width, height), pyotherside.format_argb32
+    elif image_id == 'memoryview':
+        return memoryview(bytearray(pixels)), (width, height), pyotherside.format_argb32
+    elif image_id == 'array':
+        return array.array('B', pixels), (width, height), pyotherside.format_argb32
+    elif image_id == 'strided':
+        # Not C-contiguous, must be rejected
+        return memoryview(pixels * 2)[::2], (width, height), pyotherside.format_argb32
+    elif image_id == 'padded':
+        # 3 pixels of RGB888 per row, padded to 16 bytes
+        row = b'\xff\x00\x00' * 3 + b'\x00' * 7
+        return row * 4, (3, 4), pyotherside.format_rgb888, 16
+    elif image_id == 'packed':
+        # 3 pixels of RGB888 per row, no padding
+        return b'\xff\x00\x00' * 3 * 4, (3, 4), pyotherside.format_rgb888
+    elif image_id == 'rgba8888':
+        return bytearray(b'\xff\x00\x00\xff' * 2 * 2), (2, 2), pyotherside.format_rgba8888
+    elif image_id == 'grayscale8':
+        return bytes(range(16)), (4, 4), pyotherside.format_grayscale8
+    elif image_id == 'misaligned':
+        # Starts one byte into the buffer, the pixels are copied
+        return memoryview(b'\x00' + pixels)[1:], (width, height), pyotherside.format_argb32
+    elif image_id == 'short_stride':
+        # bytes_per_line smaller than a row of pixels, must be rejected
+        return bytes(64), (4, 4), pyotherside.format_argb32, 8
+    raise ValueError(image_id)
+
+
+pyotherside.set_image_provider(image_provider)
@@ -0,0 +1,65 @@
+import QtQuick 2.0
+import io.thp.pyotherside 1.6
+import QtTest 1.2
+
+TestCase {
+    Python {
+        id: py
+        Component.onCompleted: {
+            addImportPath(Qt.resolvedUrl('.'));
+            importModule_sync('tst_image_buffer');
+        }
+    }
+
+    Image {
+        id: image
+        cache: false
+    }
+
+    function load(id) {
+        image.source = '';
+        image.source = 'image://python/' + id;
+    }
+
+    function test_buffer_types_data() {
+        return [
+            {tag: 'bytes'},
+            {tag: 'memoryview'},
+            {tag: 'array'},
+            {tag: 'misaligned'},
+        ];
+    }
+
+    function test_buffer_types(data) {
+        load(data.tag);
+        tryCompare(image, 'status', Image.Ready);
+        compare(image.implicitWidth, 4);
+        compare(image.implicitHeight, 4);
+    }
+
+    function test_formats_data() {
+        return [
+            {tag: 'padded', width: 3, height: 4},
+            {tag: 'packed', width: 3, height: 4},
+            {tag: 'rgba8888', width: 2, height: 2},
+            {tag: 'grayscale8', width: 4, height: 4},
+        ];
+    }
+
+    function test_formats(data) {
+        load(data.tag);
+        tryCompare(image, 'status', Image.Ready);
+        compare(image.implicitWidth, data.width);
+        compare(image.implicitHeight, data.height);
+    }
+
+    function test_short_stride() {
+        load('short_stride');
+        tryCompare(image, 'status', Image.Error);
+    }
+
+    function test_non_contiguous() {
+        load('strided');
+        tryCompare(image, 'status', Image.Error);
+    }
+}
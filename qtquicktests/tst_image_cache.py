@@ -0,0 +1,28 @@
+import pyotherside
+
+invocations = 0
+
+
+def image_provider(image_id, requested_size):
+    global invocations
+    invocations += 1
+
+    width, height = 4, 4
+    pixels = bytearray(b'\x00\xff\x00\xff' * width * height)
+    return pixels, (width, height), pyotherside.format_argb32
+
+
+def get_invocations():
+    return invocations
+
+
+def get_stats():
+    return pyotherside.image_cache_stats()
+
+
+def invalidate(image_id):
+    pyotherside.invalidate_image(image_id)
+
+
+pyotherside.set_image_cache_size(1024 * 1024)
+pyotherside.set_image_provider(image_provider)
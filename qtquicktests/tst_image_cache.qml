@@ -0,0 +1,43 @@
+import QtQuick 2.0
+import io.thp.pyotherside 1.6
+import QtTest 1.2
+
+TestCase {
+    Python {
+        id: py
+        Component.onCompleted: {
+            addImportPath(Qt.resolvedUrl('.'));
+            importModule_sync('tst_image_cache');
+        }
+    }
+
+    Image {
+        id: image
+        // Bypass the QML pixmap cache, so that every load reaches PyOtherSide
+        cache: false
+    }
+
+    function load(id) {
+        image.source = '';
+        image.source = 'image://python/' + id;
+        tryCompare(image, 'status', Image.Ready);
+    }
+
+    function test_cache_and_invalidate() {
+        var before = py.call_sync('tst_image_cache.get_invocations');
+        var stats = py.call_sync('tst_image_cache.get_stats');
+
+        load('tile');
+        load('tile');
+        compare(py.call_sync('tst_image_cache.get_invocations'), before + 1);
+
+        var after = py.call_sync('tst_image_cache.get_stats');
+        compare(after.hits, stats.hits + 1);
+        compare(after.misses, stats.misses + 1);
+        verify(after.size >= 4 * 4 * 4);
+
+        py.call_sync('tst_image_cache.invalidate', ['tile']);
+        load('tile');
+        compare(py.call_sync('tst_image_cache.get_invocations'), before + 2);
+    }
+}
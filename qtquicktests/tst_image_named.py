@@ -0,0 +1,29 @@
+import pyotherside
+
+
+def icon_provider(image_id, requested_size):
+    return bytearray(b'\x00\xff\x00\xff' * 4 * 4), (4, 4), pyotherside.format_argb32
+
+
+def thumbnail_provider(image_id, requested_size):
+    return bytearray(b'\xff\x00\x00\xff' * 8 * 8), (8, 8), pyotherside.format_argb32
+
+
+def cache_stats(name):
+    return pyotherside.image_cache_stats(name)
+
+
+def rejects(name):
+    try:
+        pyotherside.set_image_provider(name, icon_provider)
+    except ValueError:
+        return True
+    return False
+
+
+pyotherside.set_image_provider('tst-icons', icon_provider)
+pyotherside.set_image_provider('tst-thumbnails', thumbnail_provider, max_concurrency=2)
+
+# Room for one thumbnail, but icons have their own budget
+pyotherside.set_image_cache_size(8 * 8 * 4, 'tst-thumbnails')
+pyotherside.set_image_cache_size(1024, 'tst-icons')
@@ -0,0 +1,56 @@
+import QtQuick 2.0
+import io.thp.pyotherside 1.6
+import QtTest 1.2
+
+TestCase {
+    Python {
+        id: py
+        Component.onCompleted: {
+            addImportPath(Qt.resolvedUrl('.'));
+            importModule_sync('tst_image_named');
+        }
+    }
+
+    Image {
+        id: icon
+        cache: false
+    }
+
+    Image {
+        id: thumbnail
+        cache: false
+    }
+
+    function test_named_providers() {
+        icon.source = 'image://tst-icons/a';
+        thumbnail.source = 'image://tst-thumbnails/b';
+        tryCompare(icon, 'status', Image.Ready);
+        tryCompare(thumbnail, 'status', Image.Ready);
+        compare(icon.implicitWidth, 4);
+        compare(thumbnail.implicitWidth, 8);
+    }
+
+    function test_separate_caches() {
+        icon.source = 'image://tst-icons/cached';
+        tryCompare(icon, 'status', Image.Ready);
+        thumbnail.source = 'image://tst-thumbnails/c';
+        tryCompare(thumbnail, 'status', Image.Ready);
+        thumbnail.source = 'image://tst-thumbnails/d';
+        tryCompare(thumbnail, 'status', Image.Ready);
+
+        // Thumbnails only evict each other
+        var thumbnails = py.call_sync('tst_image_named.cache_stats', ['tst-thumbnails']);
+        compare(thumbnails.max_size, 8 * 8 * 4);
+        compare(thumbnails.count, 1);
+        var icons = py.call_sync('tst_image_named.cache_stats', ['tst-icons']);
+        compare(icons.max_size, 1024);
+        verify(icons.count >= 1);
+    }
+
+    function test_invalid_names() {
+        verify(py.call_sync('tst_image_named.rejects', ['Upper']));
+        verify(py.call_sync('tst_image_named.rejects', ['']));
+        verify(py.call_sync('tst_image_named.rejects', ['python']));
+        verify(py.call_sync('tst_image_named.rejects', ['a/b']));
+    }
+}
@@ -0,0 +1,16 @@
+import pyotherside
+
+SVG = b'''<svg xmlns="http://www.w3.org/2000/svg" width="16" height="16">
+<circle cx="8" cy="8" r="6" fill="red"/>
+</svg>'''
+
+
+def image_provider(image_id, requested_size):
+    return SVG, requested_size, pyotherside.format_svg_data
+
+
+def get_stats():
+    return pyotherside.svg_cache_stats()
+
+
+pyotherside.set_image_provider(image_provider)
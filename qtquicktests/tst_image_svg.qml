@@ -0,0 +1,39 @@
+import QtQuick 2.0
+import io.thp.pyotherside 1.6
+import QtTest 1.2
+
+TestCase {
+    Python {
+        id: py
+        Component.onCompleted: {
+            addImportPath(Qt.resolvedUrl('.'));
+            importModule_sync('tst_image_svg');
+        }
+    }
+
+    Image {
+        id: image
+        cache: false
+    }
+
+    function load(size) {
+        image.source = '';
+        image.sourceSize = Qt.size(size, size);
+        image.source = 'image://python/icon';
+        tryCompare(image, 'status', Image.Ready);
+        compare(image.implicitWidth, size);
+    }
+
+    function test_parsed_once() {
+        var before = py.call_sync('tst_image_svg.get_stats');
+
+        load(24);
+        load(32);
+        load(48);
+
+        var after = py.call_sync('tst_image_svg.get_stats');
+        compare(after.misses, before.misses + 1);
+        compare(after.hits, before.hits + 2);
+        compare(after.count, 1);
+    }
+}
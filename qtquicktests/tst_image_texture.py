@@ -0,0 +1,25 @@
+import pyotherside
+
+FORMATS = {
+    'argb32_premultiplied': (pyotherside.format_argb32_premultiplied, 4),
+    'rgb888': (pyotherside.format_rgb888, 3),
+    'argb32': (pyotherside.format_argb32, 4),
+}
+
+
+def image_provider(image_id, requested_size):
+    name, padding = image_id.split('/')
+    format, bytes_per_pixel = FORMATS[name]
+    bytes_per_line = 5 * bytes_per_pixel + int(padding)
+    return bytearray(b'\x80' * bytes_per_line * 3), (5, 3), format, bytes_per_line
+
+
+def rejects(name):
+    try:
+        pyotherside.set_image_provider(name, image_provider)
+    except ValueError:
+        return True
+    return False
+
+
+pyotherside.set_image_provider(image_provider)
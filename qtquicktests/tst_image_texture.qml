@@ -0,0 +1,39 @@
+import QtQuick 2.0
+import io.thp.pyotherside 1.6
+import QtTest 1.2
+
+TestCase {
+    Python {
+        id: py
+        Component.onCompleted: {
+            addImportPath(Qt.resolvedUrl('.'));
+            importModule_sync('tst_image_texture');
+        }
+    }
+
+    Image {
+        id: image
+        cache: false
+    }
+
+    function test_texture_data() {
+        return [
+            {tag: 'native format', id: 'argb32_premultiplied/0'},
+            {tag: 'native format with stride', id: 'argb32_premultiplied/12'},
+            {tag: 'packed rows', id: 'rgb888/0'},
+            {tag: 'converted format', id: 'argb32/0'},
+        ];
+    }
+
+    function test_texture(data) {
+        image.source = '';
+        image.source = 'image://python-texture/' + data.id;
+        tryCompare(image, 'status', Image.Ready);
+        compare(image.implicitWidth, 5);
+        compare(image.implicitHeight, 3);
+    }
+
+    function test_reserved_name() {
+        verify(py.call_sync('tst_image_texture.rejects', ['python-texture']));
+    }
+}
@@ -0,0 +1,8 @@
+def numbers(count):
+    return list(range(count))
+
+def total(values):
+    return sum(values)
+
+def fail():
+    raise ValueError('failed on purpose')
@@ -0,0 +1,53 @@
+import QtQuick 2.0
+import io.thp.pyotherside 1.6
+import QtTest 1.2
+
+TestCase {
+    property var result: undefined
+    property string rejected: ''
+
+    Python {
+        id: py
+        Component.onCompleted: addImportPath(Qt.resolvedUrl('.'));
+    }
+
+    function init() {
+        result = undefined;
+        rejected = '';
+    }
+
+    function test_resolve() {
+        py.importModule_promise('tst_promise');
+        py.call_promise('tst_promise.total', [[1, 2, 3]]).then(function (value) {
+            result = value;
+        });
+        tryCompare(this, 'result', 6);
+    }
+
+    function test_pipelined() {
+        py.importModule_promise('tst_promise');
+        var values = py.call_promise('tst_promise.numbers', [5]);
+        py.call_promise('tst_promise.total', [values]).then(function (value) {
+            result = value;
+        });
+        tryCompare(this, 'result', 10);
+    }
+
+    function test_reject() {
+        py.importModule_promise('tst_promise');
+        py.call_promise('tst_promise.fail').then(function (value) {
+            result = value;
+        }, function (error) {
+            rejected = error.message;
+        });
+        tryVerify(function () { return rejected.indexOf('failed on purpose') != -1; });
+        compare(result, undefined);
+    }
+
+    function test_reject_import() {
+        py.importModule_promise('tst_promise_does_not_exist').catch(function (error) {
+            rejected = error.message;
+        });
+        tryVerify(function () { return rejected.indexOf('Cannot import module') != -1; });
+    }
+}
@@ -0,0 +1,9 @@
+invocations = 0
+
+def celsius_to_fahrenheit(celsius):
+    global invocations
+    invocations += 1
+    return celsius * 9 / 5 + 32
+
+def get_invocations():
+    return invocations
@@ -0,0 +1,57 @@
+import QtQuick 2.0
+import io.thp.pyotherside 1.6
+import QtTest 1.2
+
+TestCase {
+    property var results: []
+
+    Python {
+        id: py
+        Component.onCompleted: {
+            addImportPath(Qt.resolvedUrl('.'));
+            importModule_sync('tst_pure');
+            setPure('tst_pure.celsius_to_fahrenheit');
+        }
+    }
+
+    function init() {
+        results = [];
+        py.clearResultCache();
+    }
+
+    function test_cache_hit() {
+        var before = py.call_sync('tst_pure.get_invocations');
+        var hits = py.cacheHits;
+        var misses = py.cacheMisses;
+
+        py.call('tst_pure.celsius_to_fahrenheit', [100], function (result) {
+            results.push(result);
+        });
+        tryCompare(results, 'length', 1);
+
+        py.call('tst_pure.celsius_to_fahrenheit', [100], function (result) {
+            results.push(result);
+        });
+        tryCompare(results, 'length', 2);
+
+        compare(results, [212, 212]);
+        compare(py.cacheHits, hits + 1);
+        compare(py.cacheMisses, misses + 1);
+        compare(py.call_sync('tst_pure.get_invocations'), before + 1);
+    }
+
+    function test_not_pure_anymore() {
+        var before = py.call_sync('tst_pure.get_invocations');
+        py.setPure('tst_pure.celsius_to_fahrenheit', false);
+
+        for (var i = 0; i < 2; i++) {
+            py.call('tst_pure.celsius_to_fahrenheit', [0], function (result) {
+                results.push(result);
+            });
+        }
+        tryCompare(results, 'length', 2);
+        compare(py.call_sync('tst_pure.get_invocations'), before + 2);
+
+        py.setPure('tst_pure.celsius_to_fahrenheit');
+    }
+}
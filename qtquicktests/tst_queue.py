@@ -0,0 +1,20 @@
+import time
+
+def block(seconds):
+    time.sleep(seconds)
+
+def echo(value):
+    return value
+
+def times_ten(value):
+    return value * 10
+
+invocations = 0
+
+def counted(value):
+    global invocations
+    invocations += 1
+    return value
+
+def get_invocations():
+    return invocations
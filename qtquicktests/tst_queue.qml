@@ -0,0 +1,99 @@
+import QtQuick 2.0
+import io.thp.pyotherside 1.6
+import QtTest 1.2
+
+TestCase {
+    property var results: []
+    property int saturatedCount: 0
+    property string lastError: ''
+
+    Python {
+        id: py
+        maxPendingCalls: 2
+        Component.onCompleted: {
+            addImportPath(Qt.resolvedUrl('.'));
+            importModule_sync('tst_queue');
+        }
+        onSaturated: saturatedCount++
+        onError: lastError = traceback
+    }
+
+    function init() {
+        results = [];
+        saturatedCount = 0;
+        lastError = '';
+    }
+
+    function fill(policy, funcs) {
+        py.overflowPolicy = policy;
+        py.call('tst_queue.block', [0.2]);
+        tryCompare(py, 'pendingCalls', 0);
+
+        for (var i = 0; i < funcs.length; i++) {
+            py.call('tst_queue.' + funcs[i], [i + 1], function (result) {
+                results.push(result);
+            });
+        }
+        compare(py.pendingCalls, 2);
+        compare(saturatedCount, funcs.length - 2);
+    }
+
+    function test_reject() {
+        fill(Python.Reject, ['echo', 'times_ten', 'echo', 'echo']);
+        tryCompare(results, 'length', 2);
+        compare(results, [1, 20]);
+        verify(lastError.indexOf('rejected') != -1);
+    }
+
+    function test_drop_oldest() {
+        fill(Python.DropOldest, ['echo', 'times_ten', 'echo', 'echo']);
+        tryCompare(results, 'length', 2);
+        compare(results, [3, 4]);
+    }
+
+    function test_coalesce() {
+        fill(Python.Coalesce, ['echo', 'times_ten', 'echo', 'echo']);
+        tryCompare(results, 'length', 2);
+        compare(results, [20, 4]);
+    }
+
+    function test_key_coalesces_queued_calls() {
+        py.maxPendingCalls = 0;
+        py.call('tst_queue.block', [0.2]);
+        tryCompare(py, 'pendingCalls', 0);
+
+        var before = py.call_sync('tst_queue.get_invocations');
+        var texts = ['a', 'ab', 'abc'];
+        for (var i = 0; i < texts.length; i++) {
+            py.call('tst_queue.counted', [texts[i]], function (result) {
+                results.push(result);
+            }, {key: 'search'});
+        }
+        compare(py.pendingCalls, 1);
+
+        tryCompare(results, 'length', 1);
+        compare(results[0], 'abc');
+        compare(py.call_sync('tst_queue.get_invocations'), before + 1);
+        py.maxPendingCalls = 2;
+    }
+
+    function test_identical_calls_share_result() {
+        py.maxPendingCalls = 0;
+        py.call('tst_queue.block', [0.2]);
+        tryCompare(py, 'pendingCalls', 0);
+
+        var before = py.call_sync('tst_queue.get_invocations');
+        py.call('tst_queue.counted', [42], function (result) {
+            results.push(result);
+        }, {key: 'details-42'});
+        py.call_promise('tst_queue.counted', [42], {key: 'details-42'}).then(function (result) {
+            results.push(result);
+        });
+        compare(py.pendingCalls, 1);
+
+        tryCompare(results, 'length', 2);
+        compare(results, [42, 42]);
+        compare(py.call_sync('tst_queue.get_invocations'), before + 1);
+        py.maxPendingCalls = 2;
+    }
+}
@@ -0,0 +1,40 @@
+import QtQuick 2.0
+import io.thp.pyotherside 1.6
+import QtTest 1.2
+
+TestCase {
+    id: test
+
+    property var early_result
+
+    Python {
+        id: py
+
+        // Issued right away, possibly before the interpreter is ready
+        Component.onCompleted: {
+            call('len', [[1, 2, 3]], function (result) {
+                test.early_result = result;
+            });
+        }
+    }
+
+    function test_becomes_ready() {
+        tryCompare(py, 'ready', true);
+    }
+
+    function test_call_before_ready_is_run() {
+        tryCompare(test, 'early_result', 3);
+    }
+
+    function test_sync_call_waits_for_ready() {
+        compare(py.evaluate('1 + 2'), 3);
+        compare(py.ready, true);
+    }
+
+    function test_qml_thread_is_main_thread() {
+        // Only the interpreter's main thread can set signal handlers
+        compare(py.evaluate('__import__("signal").signal(__import__("signal").SIGINT, ' +
+                '__import__("signal").SIG_DFL) is not None'), true);
+        compare(py.evaluate('__import__("threading").main_thread().is_alive()'), true);
+    }
+}
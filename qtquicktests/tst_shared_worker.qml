@@ -0,0 +1,73 @@
+import QtQuick 2.0
+import io.thp.pyotherside 1.6
+import QtTest 1.2
+
+TestCase {
+    property var results: []
+
+    Repeater {
+        id: repeater
+        model: 10
+
+        Item {
+            property alias python: py
+
+            Python {
+                id: py
+                sharedWorker: true
+            }
+        }
+    }
+
+    function test_shared_worker_order() {
+        var expected = [];
+        for (var i = 0; i < repeater.count; i++) {
+            var py = repeater.itemAt(i).python;
+            for (var j = 0; j < 3; j++) {
+                py.call('str', [i * 10 + j], function (result) {
+                    results.push(result);
+                });
+                expected.push('' + (i * 10 + j));
+            }
+        }
+
+        tryCompare(results, 'length', expected.length);
+
+        // Calls of each object are run in order
+        for (var i = 0; i < repeater.count; i++) {
+            var own = results.filter(function (r) { return Math.floor(parseInt(r) / 10) == i; });
+            compare(own, [i * 10, i * 10 + 1, i * 10 + 2].map(String));
+        }
+    }
+
+    function test_destroy_drops_pending_calls() {
+        var py = Qt.createQmlObject('import io.thp.pyotherside 1.6; Python { sharedWorker: true }', this);
+        py.importModule_sync('time');
+        for (var i = 0; i < 10; i++) {
+            py.call('time.sleep', [0.2]);
+        }
+        wait(50);
+
+        // Doesn't wait for the queued calls, only for the one that is running
+        var start = Date.now();
+        py.destroy();
+        wait(0);
+        verify(Date.now() - start < 1000);
+
+        // Other Python objects on the same threads don't have to wait either
+        var count = 0;
+        for (var i = 0; i < repeater.count; i++) {
+            repeater.itemAt(i).python.call('str', [i], function (result) {
+                count++;
+            });
+        }
+        tryVerify(function () { return count == repeater.count; }, 1000);
+    }
+
+    function test_cannot_change_after_start() {
+        var py = repeater.itemAt(0).python;
+        py.call('str', [1]);
+        py.sharedWorker = false;
+        compare(py.sharedWorker, true);
+    }
+}
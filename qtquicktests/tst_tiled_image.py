@@ -0,0 +1,21 @@
+import threading
+import pyotherside
+
+lock = threading.Lock()
+requested = []
+
+
+def provider(x, y, level, size):
+    with lock:
+        requested.append((x, y, level))
+
+    width, height = size
+    pixels = b'\x00\xff\x00\xff' * width * height
+    return pixels, size, pyotherside.format_argb32
+
+
+def get_requested():
+    with lock:
+        result = sorted(requested)
+        del requested[:]
+    return result
@@ -0,0 +1,74 @@
+import QtQuick 2.0
+import io.thp.pyotherside 1.6
+import QtTest 1.2
+
+TestCase {
+    Python {
+        id: py
+        Component.onCompleted: {
+            addImportPath(Qt.resolvedUrl('.'));
+            importModule_sync('tst_tiled_image');
+        }
+    }
+
+    PyTiledImage {
+        id: tiled
+        width: 1024
+        height: 512
+        sourceSize: Qt.size(1024, 512)
+        tileSize: 256
+    }
+
+    function init() {
+        tiled.provider = null;
+        tiled.viewport = Qt.rect(0, 0, 0, 0);
+        tiled.width = 1024;
+        tiled.height = 512;
+        py.call_sync('tst_tiled_image.get_requested');
+    }
+
+    function test_all_tiles() {
+        tiled.provider = py.evaluate('tst_tiled_image.provider');
+        tryCompare(tiled, 'pending', 0);
+        compare(tiled.level, 0);
+
+        var requested = py.call_sync('tst_tiled_image.get_requested');
+        compare(requested.length, 4 * 2);
+        compare(requested[0], [0, 0, 0]);
+        compare(requested[7], [3, 1, 0]);
+
+        tiled.invalidate();
+        tryCompare(tiled, 'pending', 0);
+        compare(py.call_sync('tst_tiled_image.get_requested').length, 4 * 2);
+
+        // Cached tiles are not requested again
+        tiled.viewport = Qt.rect(0, 0, 100, 100);
+        tiled.viewport = Qt.rect(0, 0, 0, 0);
+        tryCompare(tiled, 'pending', 0);
+        compare(py.call_sync('tst_tiled_image.get_requested').length, 0);
+    }
+
+    function test_viewport() {
+        // One visible tile and the tiles around it
+        tiled.viewport = Qt.rect(0, 0, 100, 100);
+        tiled.provider = py.evaluate('tst_tiled_image.provider');
+        tryCompare(tiled, 'pending', 0);
+
+        compare(py.call_sync('tst_tiled_image.get_requested'),
+                [[0, 0, 0], [0, 1, 0], [1, 0, 0], [1, 1, 0]]);
+    }
+
+    function test_coarser_level() {
+        tiled.width = 128;
+        tiled.height = 64;
+        tiled.provider = py.evaluate('tst_tiled_image.provider');
+        tryCompare(tiled, 'pending', 0);
+        verify(tiled.level > 0);
+
+        var requested = py.call_sync('tst_tiled_image.get_requested');
+        verify(requested.length < 4 * 2);
+        for (var i=0; i<requested.length; i++) {
+            compare(requested[i][2], tiled.level);
+        }
+    }
+}
@@ -0,0 +1,32 @@
+import time
+
+def spin():
+    while True:
+        pass
+
+def sleep_briefly():
+    time.sleep(0.01)
+    return 'done'
+
+def block():
+    # Blocking C call, TimeoutError is only delivered once it returns
+    time.sleep(1)
+    return 'blocked'
+
+def block_long():
+    time.sleep(3)
+    return 'blocked'
+
+cancelled = False
+
+async def wait_forever():
+    global cancelled
+    import asyncio
+    try:
+        await asyncio.sleep(3600)
+    except asyncio.CancelledError:
+        cancelled = True
+        raise
+
+def was_cancelled():
+    return cancelled
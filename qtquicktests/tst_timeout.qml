@@ -0,0 +1,90 @@
+import QtQuick 2.0
+import io.thp.pyotherside 1.6
+import QtTest 1.2
+
+TestCase {
+    property var results: []
+    property string lastError: ''
+
+    Python {
+        id: py
+        Component.onCompleted: {
+            addImportPath(Qt.resolvedUrl('.'));
+            importModule_sync('tst_timeout');
+        }
+        onError: lastError = traceback
+    }
+
+    function init() {
+        results = [];
+        lastError = '';
+    }
+
+    function test_timeout_aborts_call() {
+        var count = py.timeoutCount;
+        py.call('tst_timeout.spin', [], function (result) {
+            results.push('spin:' + result);
+        }, 100);
+        py.call('tst_timeout.sleep_briefly', [], function (result) {
+            results.push(result);
+        });
+
+        tryVerify(function () { return lastError.indexOf('timed out') != -1; });
+        tryCompare(results, 'length', 2);
+        compare(results[0], 'spin:undefined');
+        compare(results[1], 'done');
+        compare(py.timeoutCount, count + 1);
+    }
+
+    function test_timeout_during_blocking_call() {
+        py.call('tst_timeout.block', [], function (result) {
+            results.push('block:' + result);
+        }, 100);
+
+        // Called at the deadline, not when the blocking call returns
+        tryCompare(results, 'length', 1, 600);
+        compare(results[0], 'block:undefined');
+        compare(py.call_sync('tst_timeout.sleep_briefly'), 'done');
+        compare(results.length, 1);
+    }
+
+    function test_blocked_call_abandons_worker() {
+        py.call('tst_timeout.block_long', [], function (result) {
+            results.push('block:' + result);
+        }, 100);
+
+        // Later calls continue on a new worker thread
+        tryCompare(py, 'stuckCalls', 1, 2000);
+        py.call('tst_timeout.sleep_briefly', [], function (result) {
+            results.push(result);
+        });
+        tryCompare(results, 'length', 2, 1000);
+        compare(results[0], 'block:undefined');
+        compare(results[1], 'done');
+
+        // The old thread ends once the blocked call returns
+        tryCompare(py, 'stuckCalls', 0, 5000);
+        compare(results.length, 2);
+    }
+
+    function test_timeout_cancels_awaitable() {
+        var rejected = '';
+        py.call_promise('tst_timeout.wait_forever', [], {timeout: 100}).catch(function (error) {
+            rejected = error.message;
+        });
+        tryVerify(function () { return rejected.indexOf('timed out') != -1; });
+        tryVerify(function () { return py.call_sync('tst_timeout.was_cancelled'); });
+    }
+
+    function test_default_timeout() {
+        py.timeout = 100;
+        var rejected = '';
+        py.call_promise('tst_timeout.spin').catch(function (error) {
+            rejected = error.message;
+        });
+        tryVerify(function () { return rejected.indexOf('timed out') != -1; });
+        py.timeout = 0;
+
+        compare(py.call_sync('tst_timeout.sleep_briefly'), 'done');
+    }
+}
@@ -0,0 +1,131 @@
+#
+# PyOtherSide: Asynchronous Python 3 Bindings for Qt 5 and Qt 6
+# Copyright (c) 2025, Thomas Perl <m@thp.io>
+#
+# Permission to use, copy, modify, and/or distribute this software for any
+# purpose with or without fee is hereby granted, provided that the above
+# copyright notice and this permission notice appear in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+# REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+# FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+# INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+# LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+# OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+# PERFORMANCE OF THIS SOFTWARE.
+#
+
+import asyncio
+import math
+import selectors
+import traceback
+
+# Maximum number of loop iterations per step() before returning to Qt
+MAX_ITERATIONS = 100
+
+
+class _Selector(selectors.DefaultSelector):
+    """Selector that never blocks, so that the Qt event loop can wait instead
+
+    Once the event loop has no more work ready, select() stops the loop and
+    remembers how long the loop wanted to wait: the delay until its next
+    timer, or None if it only waits for I/O.
+    """
+
+    def __init__(self):
+        super().__init__()
+        self.loop = None
+        self.blocking = False
+        self.timeout = 0
+        self.iterations = 0
+
+    def select(self, timeout=None):
+        if self.blocking:
+            return super().select(timeout)
+
+        events = super().select(0)
+        self.iterations += 1
+        if not events and (timeout is None or timeout > 0):
+            self.timeout = timeout
+            self.loop.stop()
+        elif self.iterations >= MAX_ITERATIONS:
+            self.timeout = 0
+            self.loop.stop()
+
+        return events
+
+
+class Runner:
+    """Runs awaitables on an asyncio event loop in a Qt thread
+
+    The Qt event loop of the thread stays in charge: step() runs the asyncio
+    event loop until it would have to wait, and tells the thread when to
+    call it again (after a timeout, or when a file descriptor is ready;
+    call_soon_threadsafe() also makes one of them ready).
+    """
+
+    def __init__(self):
+        self.selector = _Selector()
+        self.loop = asyncio.SelectorEventLoop(self.selector)
+        self.selector.loop = self.loop
+        self.tasks = {}
+        self.done = []
+
+    def schedule(self, token, awaitable):
+        task = asyncio.ensure_future(awaitable, loop=self.loop)
+        self.tasks[task] = token
+        task.add_done_callback(self._task_done)
+
+    def cancel(self, token):
+        for task, task_token in self.tasks.items():
+            if task_token == token:
+                task.cancel()
+                break
+
+    def _task_done(self, task):
+        token = self.tasks.pop(task)
+        if task.cancelled():
+            self.done.append((token, False, 'Task was cancelled'))
+            return
+
+        exc = task.exception()
+        if exc is not None:
+            message = ''.join(traceback.format_exception(type(exc), exc, exc.__traceback__))
+            self.done.append((token, False, message))
+        else:
+            self.done.append((token, True, task.result()))
+
+    def step(self):
+        """Run the event loop without blocking until it would have to wait
+
+        Returns (timeout, fds, finished), where timeout is the number of
+        milliseconds after which step() should be called again (-1 for no
+        timeout), fds is a list of (fd, events) with a mask of
+        selectors.EVENT_READ and selectors.EVENT_WRITE, which should also
+        cause a call to step() when ready, and finished is a list of
+        (token, ok, value) for all awaitables that finished during this
+        step. Without tasks left, there is nothing to wait for.
+        """
+        if self.tasks:
+            self.selector.iterations = 0
+            self.loop.run_forever()
+
+        finished, self.done = self.done, []
+        if not self.tasks:
+            return -1, [], finished
+
+        timeout = self.selector.timeout
+        timeout = -1 if timeout is None else math.ceil(timeout * 1000)
+        fds = [(key.fd, key.events) for key in self.selector.get_map().values()]
+        return timeout, fds, finished
+
+    def close(self):
+        self.selector.blocking = True
+
+        for task in list(self.tasks):
+            task.cancel()
+
+        if self.tasks:
+            self.loop.run_until_complete(asyncio.gather(*self.tasks, return_exceptions=True))
+
+        self.loop.close()
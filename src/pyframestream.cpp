@@ -0,0 +1,223 @@
+/**
+ * PyOtherSide: Asynchronous Python 3 Bindings for Qt 5 and Qt 6
+ * Copyright (c) 2011, 2013-2025, Thomas Perl <m@thp.io>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ **/
+
+#include "pyframestream.h"
+#include "qpython_texturefactory.h"
+
+#include <QMetaObject>
+#include <QtQuick/QQuickWindow>
+#include <QtQuick/QSGSimpleTextureNode>
+
+
+class PyFrameStreamNode : public QSGSimpleTextureNode {
+public:
+    PyFrameStreamNode()
+        : QSGSimpleTextureNode()
+        , ring()
+    {
+    }
+
+    ~PyFrameStreamNode()
+    {
+        delete texture();
+    }
+
+    // Keeps the presented buffer alive while the texture might use it
+    QSharedPointer<QPythonFrameRing> ring;
+};
+
+
+PyFrameStream::PyFrameStream(QQuickItem *parent)
+    : QQuickItem(parent)
+    , m_name()
+    , m_frameSize()
+    , m_format(ARGB32Premultiplied)
+    , m_bufferCount(3)
+    , m_presentedFrames(0)
+    , m_droppedFrames(0)
+    , m_ring()
+{
+    setFlag(ItemHasContents, true);
+}
+
+PyFrameStream::~PyFrameStream()
+{
+    releaseRing();
+}
+
+void
+PyFrameStream::setName(const QString &name)
+{
+    if (name == m_name) {
+        return;
+    }
+
+    releaseRing();
+    m_name = name;
+    emit nameChanged();
+    updateRing();
+}
+
+void
+PyFrameStream::setFrameSize(const QSize &frameSize)
+{
+    if (frameSize == m_frameSize) {
+        return;
+    }
+
+    releaseRing();
+    m_frameSize = frameSize;
+    setImplicitSize(frameSize.width(), frameSize.height());
+    emit frameSizeChanged();
+    updateRing();
+}
+
+void
+PyFrameStream::setFormat(Format format)
+{
+    if (format == m_format) {
+        return;
+    }
+
+    releaseRing();
+    m_format = format;
+    emit formatChanged();
+    updateRing();
+}
+
+void
+PyFrameStream::setBufferCount(int bufferCount)
+{
+    // One buffer for the presented frame, one for the next one
+    bufferCount = qMax(2, bufferCount);
+    if (bufferCount == m_bufferCount) {
+        return;
+    }
+
+    releaseRing();
+    m_bufferCount = bufferCount;
+    emit bufferCountChanged();
+    updateRing();
+}
+
+void
+PyFrameStream::componentComplete()
+{
+    QQuickItem::componentComplete();
+    updateRing();
+}
+
+void
+PyFrameStream::releaseRing()
+{
+    if (!m_ring) {
+        return;
+    }
+
+    QObject::disconnect(m_ring.data(), SIGNAL(frameCommitted()), this, SLOT(frameCommitted()));
+    QPythonFrameRing::unregisterRing(m_name, m_ring.data());
+    m_ring.clear();
+}
+
+void
+PyFrameStream::updateRing()
+{
+    if (!isComponentComplete() || m_name.isEmpty() || m_frameSize.isEmpty()) {
+        return;
+    }
+
+    // Python might release the last reference from any thread
+    m_ring = QSharedPointer<QPythonFrameRing>(new QPythonFrameRing(m_frameSize,
+                (QImage::Format)m_format, m_bufferCount), &QObject::deleteLater);
+    QObject::connect(m_ring.data(), SIGNAL(frameCommitted()), this, SLOT(frameCommitted()));
+    QPythonFrameRing::registerRing(m_name, m_ring);
+
+    // Counts are per ring, i.e. since the stream was last (re)configured
+    if (m_presentedFrames != 0) {
+        m_presentedFrames = 0;
+        emit presentedFramesChanged();
+    }
+
+    if (m_droppedFrames != 0) {
+        m_droppedFrames = 0;
+        emit droppedFramesChanged();
+    }
+}
+
+void
+PyFrameStream::frameCommitted()
+{
+    updateCounts();
+    update();
+}
+
+void
+PyFrameStream::updateCounts()
+{
+    if (!m_ring) {
+        return;
+    }
+
+    int presented = m_ring->presented();
+    if (presented != m_presentedFrames) {
+        m_presentedFrames = presented;
+        emit presentedFramesChanged();
+    }
+
+    int dropped = m_ring->dropped();
+    if (dropped != m_droppedFrames) {
+        m_droppedFrames = dropped;
+        emit droppedFramesChanged();
+    }
+}
+
+QSGNode *
+PyFrameStream::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data)
+{
+    Q_UNUSED(data);
+
+    PyFrameStreamNode *node = static_cast<PyFrameStreamNode *>(oldNode);
+
+    QImage frame;
+    if (m_ring) {
+        frame = m_ring->takeNewest();
+    }
+
+    if (!frame.isNull()) {
+        if (!node) {
+            node = new PyFrameStreamNode;
+        }
+
+        // The old texture goes back to the pool before the new one is
+        // uploaded (on first bind), so that it can be reused
+        // (see QPythonTexturePool)
+        QSGTexture *old = node->texture();
+        node->setTexture(QPythonTextureFactory(frame).createTexture(window()));
+        delete old;
+        node->ring = m_ring;
+
+        // Counts are read on the GUI thread
+        QMetaObject::invokeMethod(this, "updateCounts", Qt::QueuedConnection);
+    }
+
+    if (node) {
+        node->setRect(boundingRect());
+        node->setFiltering(smooth() ? QSGTexture::Linear : QSGTexture::Nearest);
+    }
+
+    return node;
+}
@@ -0,0 +1,101 @@
+/**
+ * PyOtherSide: Asynchronous Python 3 Bindings for Qt 5 and Qt 6
+ * Copyright (c) 2011, 2013-2025, Thomas Perl <m@thp.io>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ **/
+
+#ifndef PYOTHERSIDE_PYFRAMESTREAM_H
+#define PYOTHERSIDE_PYFRAMESTREAM_H
+
+#include <QString>
+#include <QSize>
+#include <QImage>
+#include <QSharedPointer>
+#include <QtQuick/QQuickItem>
+
+#include "qpython_framestream.h"
+
+
+// Shows frames that Python writes into a ring of preallocated buffers
+// (pyotherside.acquire_frame() / pyotherside.commit_frame()). The newest
+// committed frame is shown on the next scene graph sync; frames that are
+// replaced before that are dropped.
+class PyFrameStream : public QQuickItem
+{
+    Q_OBJECT
+    Q_ENUMS(Format)
+    Q_PROPERTY(QString name READ name WRITE setName NOTIFY nameChanged)
+    Q_PROPERTY(QSize frameSize READ frameSize WRITE setFrameSize NOTIFY frameSizeChanged)
+    Q_PROPERTY(Format format READ format WRITE setFormat NOTIFY formatChanged)
+    Q_PROPERTY(int bufferCount READ bufferCount WRITE setBufferCount NOTIFY bufferCountChanged)
+    Q_PROPERTY(int presentedFrames READ presentedFrames NOTIFY presentedFramesChanged)
+    Q_PROPERTY(int droppedFrames READ droppedFrames NOTIFY droppedFramesChanged)
+
+public:
+    // Same values as the pyotherside.format_* constants
+    enum Format {
+        RGB32 = QImage::Format_RGB32,
+        ARGB32Premultiplied = QImage::Format_ARGB32_Premultiplied,
+        RGB888 = QImage::Format_RGB888,
+    };
+
+    PyFrameStream(QQuickItem *parent=0);
+    ~PyFrameStream();
+
+    QString name() const { return m_name; }
+    void setName(const QString &name);
+
+    QSize frameSize() const { return m_frameSize; }
+    void setFrameSize(const QSize &frameSize);
+
+    Format format() const { return m_format; }
+    void setFormat(Format format);
+
+    int bufferCount() const { return m_bufferCount; }
+    void setBufferCount(int bufferCount);
+
+    int presentedFrames() const { return m_presentedFrames; }
+    int droppedFrames() const { return m_droppedFrames; }
+
+signals:
+    void nameChanged();
+    void frameSizeChanged();
+    void formatChanged();
+    void bufferCountChanged();
+    void presentedFramesChanged();
+    void droppedFramesChanged();
+
+protected:
+    virtual void componentComplete();
+    virtual QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data);
+
+private slots:
+    void frameCommitted();
+    void updateCounts();
+
+private:
+    void releaseRing();
+    void updateRing();
+
+    QString m_name;
+    QSize m_frameSize;
+    Format m_format;
+    int m_bufferCount;
+    int m_presentedFrames;
+    int m_droppedFrames;
+
+    QSharedPointer<QPythonFrameRing> m_ring;
+};
+
+#endif /* PYOTHERSIDE_PYFRAMESTREAM_H */
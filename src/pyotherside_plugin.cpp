@@ -20,6 +20,8 @@
 #include "qpython.h"
 #include "pyglarea.h"
 #include "pyfbo.h"
+#include "pytiledimage.h"
+#include "pyframestream.h"
 #include "qpython_imageprovider.h"
 #include "global_libpython_loader.h"
 #include "pythonlib_loader.h"
@@ -53,10 +55,22 @@ PyOtherSideExtensionPlugin::initializeEngine(QQmlEngine *engine, const char *uri
     // load libpython again RTLD_GLOBAL again. We do this here.
     GlobalLibPythonLoader::loadPythonGlobally();
 
-    // Extract and load embedded Python Standard Library, if necessary
+    // Make the embedded Python Standard Library available, if necessary
     PythonLibLoader::extractPythonLibrary();
 
+    // Start the interpreter, and import modules on a separate thread, so
+    // that the UI can show its first frame without waiting (QPython::ready)
+    QPythonPriv::start(true);
+
     engine->addImageProvider(PYOTHERSIDE_IMAGEPROVIDER_ID, new QPythonImageProvider);
+    engine->addImageProvider(PYOTHERSIDE_TEXTURE_IMAGEPROVIDER_ID,
+            new QPythonImageProvider(QString(), QQmlImageProviderBase::Texture));
+#if QT_VERSION >= QT_VERSION_CHECK(5, 6, 0)
+    engine->addImageProvider(PYOTHERSIDE_ASYNC_IMAGEPROVIDER_ID, new QPythonAsyncImageProvider);
+#endif
+
+    // Named image providers from pyotherside.set_image_provider(name, ...)
+    QPythonImageProviderRegistry::instance()->addEngine(engine);
 }
 
 void
@@ -69,6 +83,9 @@ PyOtherSideExtensionPlugin::registerTypes(const char *uri)
     qmlRegisterType<QPython13>(uri, 1, 3, PYOTHERSIDE_QPYTHON_NAME);
     qmlRegisterType<QPython14>(uri, 1, 4, PYOTHERSIDE_QPYTHON_NAME);
     qmlRegisterType<QPython15>(uri, 1, 5, PYOTHERSIDE_QPYTHON_NAME);
+    qmlRegisterType<QPython16>(uri, 1, 6, PYOTHERSIDE_QPYTHON_NAME);
     qmlRegisterType<PyGLArea>(uri, 1, 5, PYOTHERSIDE_QPYGLAREA_NAME);
     qmlRegisterType<PyFbo>(uri, 1, 5, PYOTHERSIDE_PYFBO_NAME);
+    qmlRegisterType<PyTiledImage>(uri, 1, 6, PYOTHERSIDE_PYTILEDIMAGE_NAME);
+    qmlRegisterType<PyFrameStream>(uri, 1, 6, PYOTHERSIDE_PYFRAMESTREAM_NAME);
 }
@@ -24,9 +24,13 @@
 
 #define PYOTHERSIDE_PLUGIN_ID "io.thp.pyotherside"
 #define PYOTHERSIDE_IMAGEPROVIDER_ID "python"
+#define PYOTHERSIDE_ASYNC_IMAGEPROVIDER_ID "python-async"
+#define PYOTHERSIDE_TEXTURE_IMAGEPROVIDER_ID "python-texture"
 #define PYOTHERSIDE_QPYTHON_NAME "Python"
 #define PYOTHERSIDE_QPYGLAREA_NAME "PyGLArea"
 #define PYOTHERSIDE_PYFBO_NAME "PyFBO"
+#define PYOTHERSIDE_PYTILEDIMAGE_NAME "PyTiledImage"
+#define PYOTHERSIDE_PYFRAMESTREAM_NAME "PyFrameStream"
 
 class Q_DECL_EXPORT PyOtherSideExtensionPlugin : public QQmlExtensionPlugin {
     Q_OBJECT
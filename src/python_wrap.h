@@ -4,3 +4,8 @@
 #undef slots
 #include "Python.h"
 #pragma pop_macro("slots")
+
+#if PY_VERSION_HEX < 0x03090000
+// PyObject_Vectorcall() was provisional (and underscore-prefixed) in 3.8
+#  define PyObject_Vectorcall _PyObject_Vectorcall
+#endif
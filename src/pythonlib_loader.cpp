@@ -17,8 +17,8 @@
  **/
 
 #include "pythonlib_loader.h"
+#include "qpython_priv.h"
 
-#include <QStandardPaths>
 #include <QDir>
 #include <QDebug>
 
@@ -28,27 +28,15 @@
 
 namespace PythonLibLoader {
 
-static void prependPythonPath(const QString &path)
-{
-    QString pythonpath(path + ":" + QString::fromUtf8(qgetenv("PYTHONPATH")));
-    QByteArray pythonpath_utf8 = pythonpath.toUtf8();
-    qputenv("PYTHONPATH", pythonpath_utf8.constData());
-}
-
 #if defined(PYTHONLIB_LOADER_HAVE_PYTHONLIB_ZIP)
 
 bool extractPythonLibrary()
 {
-    QString source(":/io/thp/pyotherside/pythonlib.zip");
-    QString destdir(QStandardPaths::writableLocation(QStandardPaths::TempLocation));
-    QString destination(QDir(destdir).filePath("pythonlib.zip"));
-    prependPythonPath(destination);
-
-    if (QFile::exists(destination)) {
-        return true;
-    }
-
-    return QFile::copy(source, destination);
+    // Imported directly from the Qt Resource (by qrc_zipimporter.py, which
+    // reads only the parts it needs from the resource data), so no copy of
+    // the archive is written to disk and none can be stale after an update
+    QPythonPriv::addModuleSearchPath(":/io/thp/pyotherside/pythonlib.zip");
+    return true;
 }
 
 #else /* PYTHONLIB_LOADER_HAVE_PYTHONLIB_ZIP */
@@ -91,7 +79,7 @@ bool extractPythonLibrary()
             }
         }
     }
-    prependPythonPath(fname);
+    QPythonPriv::addModuleSearchPath(fname);
 #endif
     return true;
 }
@@ -0,0 +1,533 @@
+/**
+ * PyOtherSide: Asynchronous Python 3 Bindings for Qt 5 and Qt 6
+ * Copyright (c) 2011, 2013-2025, Thomas Perl <m@thp.io>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ **/
+
+#include "qpython_priv.h"
+#include "qpython_imageprovider.h"
+#include "pytiledimage.h"
+#include "ensure_gil_state.h"
+
+#include <QDebug>
+#include <QHash>
+#include <QRunnable>
+#include <QMutexLocker>
+#include <QMetaType>
+#include <QtMath>
+#include <QtQuick/QQuickWindow>
+#include <QtQuick/QSGSimpleTextureNode>
+
+#include <algorithm>
+#include <climits>
+
+
+// Tiles are identified by level of detail and column/row in that level
+static quint64
+tile_key(int level, int x, int y)
+{
+    return ((quint64)level << 56) | ((quint64)y << 28) | (quint64)x;
+}
+
+static int tile_level(quint64 key) { return (int)(key >> 56); }
+static int tile_y(quint64 key) { return (int)((key >> 28) & 0xFFFFFFF); }
+static int tile_x(quint64 key) { return (int)(key & 0xFFFFFFF); }
+
+
+class PyTiledImageTask : public QRunnable {
+public:
+    PyTiledImageTask(PyTiledImage *item, QSharedPointer<PyObjectRef> provider,
+            int generation, quint64 key, const QSize &size)
+        : QRunnable()
+        , m_item(item)
+        , m_provider(provider)
+        , m_generation(generation)
+        , m_key(key)
+        , m_size(size)
+    {
+    }
+
+    virtual void run();
+
+private:
+    PyTiledImage *m_item;
+    QSharedPointer<PyObjectRef> m_provider;
+    int m_generation;
+    quint64 m_key;
+    QSize m_size;
+};
+
+void
+PyTiledImageTask::run()
+{
+    // The item waits for the pool before it is destroyed, so m_item is valid
+    if (!m_item->isWanted(m_generation, m_key)) {
+        // Scrolled away (or invalidated) before this tile was started
+        QMetaObject::invokeMethod(m_item, "tileSkipped", Qt::QueuedConnection,
+                Q_ARG(int, m_generation), Q_ARG(quint64, m_key));
+        return;
+    }
+
+    QImage image;
+    QPythonEncodedImage encoded;
+
+    if (QPythonPriv::instance()) {
+        ENSURE_GIL_STATE;
+
+        PyObjectRef result(PyObject_CallFunction(m_provider->borrow(), "iii(ii)",
+                    tile_x(m_key), tile_y(m_key), tile_level(m_key),
+                    m_size.width(), m_size.height()), true);
+        if (!result) {
+            qWarning() << "Error while calling the tile provider";
+            PyErr_Print();
+        } else {
+            image = QPythonImageProvider::convertResult(result.borrow(), &encoded);
+        }
+    }
+
+    if (encoded.view) {
+        image = encoded.decode(m_size);
+        encoded.release();
+    }
+
+    QMetaObject::invokeMethod(m_item, "tileLoaded", Qt::QueuedConnection,
+            Q_ARG(int, m_generation), Q_ARG(quint64, m_key), Q_ARG(QImage, image));
+}
+
+
+class PyTiledImageTileNode : public QSGSimpleTextureNode {
+public:
+    PyTiledImageTileNode(QSGTexture *texture)
+        : QSGSimpleTextureNode()
+    {
+        setTexture(texture);
+        setFiltering(QSGTexture::Linear);
+    }
+
+    ~PyTiledImageTileNode()
+    {
+        delete texture();
+    }
+};
+
+class PyTiledImageNode : public QSGNode {
+public:
+    PyTiledImageNode() : QSGNode(), tiles(), generation(-1) {}
+
+    ~PyTiledImageNode()
+    {
+        removeAllChildNodes();
+        qDeleteAll(tiles);
+    }
+
+    QHash<quint64, PyTiledImageTileNode *> tiles;
+    int generation;
+};
+
+
+PyTiledImage::PyTiledImage(QQuickItem *parent)
+    : QQuickItem(parent)
+    , m_provider()
+    , m_providerRef()
+    , m_sourceSize()
+    , m_tileSize(256)
+    , m_viewport()
+    , m_level(0)
+    , m_cacheSize(64 * 1024 * 1024)
+    , m_cache(m_cacheSize)
+    , m_pending()
+    , m_failed()
+    , m_evicted()
+    , m_display()
+    , m_wantedMutex()
+    , m_wanted()
+    , m_generation(0)
+    , m_pool()
+{
+    setFlag(ItemHasContents, true);
+
+    QObject::connect(this, SIGNAL(widthChanged()), this, SLOT(updateTiles()));
+    QObject::connect(this, SIGNAL(heightChanged()), this, SLOT(updateTiles()));
+    QObject::connect(this, SIGNAL(windowChanged(QQuickWindow *)), this, SLOT(updateTiles()));
+}
+
+PyTiledImage::~PyTiledImage()
+{
+    {
+        QMutexLocker lock(&m_wantedMutex);
+        m_generation++;
+        m_wanted.clear();
+    }
+
+    // Queued tasks will be skipped, running ones still need to finish
+    m_pool.waitForDone();
+}
+
+void
+PyTiledImage::setProvider(QVariant provider)
+{
+    if (provider == m_provider) {
+        return;
+    }
+
+    m_provider = provider;
+    m_providerRef.clear();
+
+    if (provider.userType() == qMetaTypeId<PyObjectRef>()) {
+        m_providerRef = QSharedPointer<PyObjectRef>(new PyObjectRef(provider.value<PyObjectRef>()));
+    } else if (!provider.isNull()) {
+        qWarning() << "Tile provider must be a Python callable (got" << provider << ")";
+    }
+
+    emit providerChanged();
+    invalidate();
+}
+
+void
+PyTiledImage::setSourceSize(const QSize &sourceSize)
+{
+    if (sourceSize == m_sourceSize) {
+        return;
+    }
+
+    m_sourceSize = sourceSize;
+    emit sourceSizeChanged();
+    invalidate();
+}
+
+void
+PyTiledImage::setTileSize(int tileSize)
+{
+    if (tileSize == m_tileSize) {
+        return;
+    }
+
+    m_tileSize = tileSize;
+    emit tileSizeChanged();
+    invalidate();
+}
+
+void
+PyTiledImage::setViewport(const QRectF &viewport)
+{
+    if (viewport == m_viewport) {
+        return;
+    }
+
+    m_viewport = viewport;
+    emit viewportChanged();
+    updateTiles();
+}
+
+void
+PyTiledImage::setCacheSize(int cacheSize)
+{
+    if (cacheSize == m_cacheSize) {
+        return;
+    }
+
+    // The actual limit is set in updateTiles()
+    m_cacheSize = cacheSize;
+    emit cacheSizeChanged();
+    updateTiles();
+}
+
+void
+PyTiledImage::invalidate()
+{
+    {
+        QMutexLocker lock(&m_wantedMutex);
+        m_generation++;
+        m_wanted.clear();
+    }
+
+    m_cache.clear();
+    m_failed.clear();
+    m_evicted.clear();
+    if (!m_pending.isEmpty()) {
+        m_pending.clear();
+        emit pendingChanged();
+    }
+
+    updateTiles();
+}
+
+bool
+PyTiledImage::isWanted(int generation, quint64 key)
+{
+    QMutexLocker lock(&m_wantedMutex);
+    return generation == m_generation && m_wanted.contains(key);
+}
+
+QRectF
+PyTiledImage::tileRect(quint64 key) const
+{
+    // Area of the tile in source image pixels, mapped to item coordinates
+    qreal size = (qreal)m_tileSize * (1 << tile_level(key));
+    QRectF source = QRectF(tile_x(key) * size, tile_y(key) * size, size, size)
+        .intersected(QRectF(QPointF(0, 0), QSizeF(m_sourceSize)));
+
+    qreal sx = width() / m_sourceSize.width();
+    qreal sy = height() / m_sourceSize.height();
+    return QRectF(source.x() * sx, source.y() * sy, source.width() * sx, source.height() * sy);
+}
+
+struct PyTiledImageCandidate {
+    quint64 key;
+    bool visible;
+    qreal distance;
+};
+
+static bool
+candidate_less(const PyTiledImageCandidate &a, const PyTiledImageCandidate &b)
+{
+    // Visible tiles first, then closest to the center of the viewport first
+    if (a.visible != b.visible) {
+        return a.visible;
+    }
+
+    return a.distance < b.distance;
+}
+
+void
+PyTiledImage::updateTiles()
+{
+    m_display.clear();
+
+    if (!m_providerRef || m_sourceSize.isEmpty() || m_tileSize <= 0 ||
+            width() <= 0 || height() <= 0) {
+        update();
+        return;
+    }
+
+    // Level 0 is the full resolution, each further level halves it, up to
+    // the level where the whole image fits into a single tile
+    int maxLevel = 0;
+    while (maxLevel < 30 && (qMax(m_sourceSize.width(), m_sourceSize.height()) >> maxLevel) > m_tileSize) {
+        maxLevel++;
+    }
+
+    // Pick the coarsest level that still has one pixel per device pixel
+    qreal factor = qMax(width() / m_sourceSize.width(), height() / m_sourceSize.height());
+    if (window()) {
+        factor *= window()->devicePixelRatio();
+    }
+
+    int level = 0;
+    while (level < maxLevel && factor * (1 << (level + 1)) <= 1.0) {
+        level++;
+    }
+
+    if (level != m_level) {
+        m_level = level;
+        emit levelChanged();
+    }
+
+    QRectF view = boundingRect();
+    if (!m_viewport.isEmpty()) {
+        view = view.intersected(m_viewport);
+    }
+
+    int scale = 1 << level;
+    int levelWidth = (m_sourceSize.width() + scale - 1) / scale;
+    int levelHeight = (m_sourceSize.height() + scale - 1) / scale;
+    int columns = (levelWidth + m_tileSize - 1) / m_tileSize;
+    int rows = (levelHeight + m_tileSize - 1) / m_tileSize;
+
+    // Size of a tile in item coordinates
+    qreal tileWidth = width() * m_tileSize * scale / m_sourceSize.width();
+    qreal tileHeight = height() * m_tileSize * scale / m_sourceSize.height();
+
+    // Visible tiles and one more tile around them, which are prefetched
+    int x0 = qMax(0, qFloor(view.left() / tileWidth) - 1);
+    int x1 = qMin(columns - 1, qFloor(view.right() / tileWidth) + 1);
+    int y0 = qMax(0, qFloor(view.top() / tileHeight) - 1);
+    int y1 = qMin(rows - 1, qFloor(view.bottom() / tileHeight) + 1);
+
+    QList<PyTiledImageCandidate> candidates;
+    QSet<quint64> wanted;
+    for (int y=y0; y<=y1; y++) {
+        for (int x=x0; x<=x1; x++) {
+            PyTiledImageCandidate candidate;
+            candidate.key = tile_key(level, x, y);
+            QRectF rect = tileRect(candidate.key);
+            candidate.visible = rect.intersects(view);
+            QPointF d = rect.center() - view.center();
+            candidate.distance = d.x() * d.x() + d.y() * d.y();
+            candidates << candidate;
+            wanted.insert(candidate.key);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), candidate_less);
+
+    {
+        QMutexLocker lock(&m_wantedMutex);
+        if (wanted != m_wanted) {
+            m_evicted.clear();
+        }
+        m_wanted = wanted;
+    }
+
+    // Make room for at least all wanted tiles (assuming 32 bits per pixel),
+    // otherwise they would keep evicting each other and be requested again
+    int minimumCost = qMin((qint64)INT_MAX, (qint64)wanted.count() * m_tileSize * m_tileSize * 4);
+    m_cache.setMaxCost(qMax(m_cacheSize, minimumCost));
+
+    int pending = m_pending.count();
+    QList<quint64> fallback;
+    QList<quint64> tiles;
+
+    for (int i=0; i<candidates.count(); i++) {
+        quint64 key = candidates[i].key;
+        int x = tile_x(key);
+        int y = tile_y(key);
+
+        if (m_cache.contains(key)) {
+            if (candidates[i].visible) {
+                tiles << key;
+            }
+            continue;
+        }
+
+        if (candidates[i].visible) {
+            // Show the closest coarser tile that we have in the meantime
+            for (int l=level+1; l<=maxLevel; l++) {
+                quint64 coarse = tile_key(l, x >> (l - level), y >> (l - level));
+                if (m_cache.contains(coarse)) {
+                    if (!fallback.contains(coarse)) {
+                        fallback << coarse;
+                    }
+                    break;
+                }
+            }
+        }
+
+        if (m_pending.contains(key) || m_failed.contains(key) || m_evicted.contains(key)) {
+            continue;
+        }
+
+        QSize size(qMin(m_tileSize, levelWidth - x * m_tileSize),
+                   qMin(m_tileSize, levelHeight - y * m_tileSize));
+
+        m_pending.insert(key);
+        m_pool.start(new PyTiledImageTask(this, m_providerRef, m_generation, key, size),
+                candidates.count() - i);
+    }
+
+    // Draw coarser levels first, so that finer tiles are drawn on top
+    std::sort(fallback.begin(), fallback.end());
+    std::reverse(fallback.begin(), fallback.end());
+    m_display = fallback + tiles;
+
+    if (m_pending.count() != pending) {
+        emit pendingChanged();
+    }
+
+    update();
+}
+
+void
+PyTiledImage::tileLoaded(int generation, quint64 key, QImage image)
+{
+    if (generation != m_generation) {
+        return;
+    }
+
+    m_pending.remove(key);
+    if (image.isNull()) {
+        // Don't request this tile again until invalidate()
+        m_failed.insert(key);
+    } else {
+        QList<quint64> cached;
+        {
+            QMutexLocker lock(&m_wantedMutex);
+            QSet<quint64>::const_iterator it;
+            for (it = m_wanted.constBegin(); it != m_wanted.constEnd(); ++it) {
+                if (*it != key && m_cache.contains(*it)) {
+                    cached << *it;
+                }
+            }
+        }
+
+        if (!m_cache.insert(key, new QImage(image), image.bytesPerLine() * image.height())) {
+            qWarning() << "Tile does not fit into the cache:" << image.size();
+            m_failed.insert(key);
+        }
+
+        for (int i=0; i<cached.count(); i++) {
+            if (!m_cache.contains(cached[i])) {
+                m_evicted.insert(cached[i]);
+            }
+        }
+    }
+    emit pendingChanged();
+
+    updateTiles();
+}
+
+void
+PyTiledImage::tileSkipped(int generation, quint64 key)
+{
+    if (generation != m_generation) {
+        return;
+    }
+
+    m_pending.remove(key);
+    emit pendingChanged();
+
+    // Might be wanted again by now
+    updateTiles();
+}
+
+QSGNode *
+PyTiledImage::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data)
+{
+    Q_UNUSED(data);
+
+    PyTiledImageNode *root = static_cast<PyTiledImageNode *>(oldNode);
+    if (!root) {
+        root = new PyTiledImageNode;
+    }
+
+    if (root->generation != m_generation) {
+        root->removeAllChildNodes();
+        qDeleteAll(root->tiles);
+        root->tiles.clear();
+        root->generation = m_generation;
+    }
+
+    // Textures are kept for tiles that are still displayed
+    root->removeAllChildNodes();
+    QHash<quint64, PyTiledImageTileNode *> tiles;
+    for (int i=0; i<m_display.count(); i++) {
+        quint64 key = m_display[i];
+        QImage *image = m_cache.object(key);
+        if (!image) {
+            continue;
+        }
+
+        PyTiledImageTileNode *node = root->tiles.take(key);
+        if (!node) {
+            node = new PyTiledImageTileNode(window()->createTextureFromImage(*image));
+        }
+        node->setRect(tileRect(key));
+        root->appendChildNode(node);
+        tiles.insert(key, node);
+    }
+
+    qDeleteAll(root->tiles);
+    root->tiles = tiles;
+
+    return root;
+}
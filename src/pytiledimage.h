@@ -0,0 +1,126 @@
+/**
+ * PyOtherSide: Asynchronous Python 3 Bindings for Qt 5 and Qt 6
+ * Copyright (c) 2011, 2013-2025, Thomas Perl <m@thp.io>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ **/
+
+#ifndef PYOTHERSIDE_PYTILEDIMAGE_H
+#define PYOTHERSIDE_PYTILEDIMAGE_H
+
+#include "python_wrap.h"
+
+#include <QVariant>
+#include <QSize>
+#include <QRectF>
+#include <QImage>
+#include <QCache>
+#include <QSet>
+#include <QList>
+#include <QMutex>
+#include <QThreadPool>
+#include <QSharedPointer>
+#include <QtQuick/QQuickItem>
+
+#include "pyobject_ref.h"
+
+
+// Displays a very large image that is generated tile by tile in Python.
+// Tiles are requested on a thread pool (visible tiles first, closest to the
+// center of the viewport first), cached per level of detail and shown as
+// soon as they arrive; coarser tiles are shown in place of missing ones.
+class PyTiledImage : public QQuickItem
+{
+    Q_OBJECT
+    Q_PROPERTY(QVariant provider READ provider WRITE setProvider NOTIFY providerChanged)
+    Q_PROPERTY(QSize sourceSize READ sourceSize WRITE setSourceSize NOTIFY sourceSizeChanged)
+    Q_PROPERTY(int tileSize READ tileSize WRITE setTileSize NOTIFY tileSizeChanged)
+    Q_PROPERTY(QRectF viewport READ viewport WRITE setViewport NOTIFY viewportChanged)
+    Q_PROPERTY(int cacheSize READ cacheSize WRITE setCacheSize NOTIFY cacheSizeChanged)
+    Q_PROPERTY(int level READ level NOTIFY levelChanged)
+    Q_PROPERTY(int pending READ pending NOTIFY pendingChanged)
+
+public:
+    PyTiledImage(QQuickItem *parent=0);
+    ~PyTiledImage();
+
+    QVariant provider() const { return m_provider; }
+    void setProvider(QVariant provider);
+
+    QSize sourceSize() const { return m_sourceSize; }
+    void setSourceSize(const QSize &sourceSize);
+
+    int tileSize() const { return m_tileSize; }
+    void setTileSize(int tileSize);
+
+    QRectF viewport() const { return m_viewport; }
+    void setViewport(const QRectF &viewport);
+
+    int cacheSize() const { return m_cacheSize; }
+    void setCacheSize(int cacheSize);
+
+    int level() const { return m_level; }
+    int pending() const { return m_pending.count(); }
+
+    // Drop all tiles and request them again (e.g. if the data has changed)
+    Q_INVOKABLE void invalidate();
+
+    // Called from the thread pool
+    bool isWanted(int generation, quint64 key);
+
+signals:
+    void providerChanged();
+    void sourceSizeChanged();
+    void tileSizeChanged();
+    void viewportChanged();
+    void cacheSizeChanged();
+    void levelChanged();
+    void pendingChanged();
+
+protected:
+    virtual QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data);
+
+private slots:
+    void updateTiles();
+    void tileLoaded(int generation, quint64 key, QImage image);
+    void tileSkipped(int generation, quint64 key);
+
+private:
+    QRectF tileRect(quint64 key) const;
+
+    QVariant m_provider;
+    QSharedPointer<PyObjectRef> m_providerRef;
+    QSize m_sourceSize;
+    int m_tileSize;
+    QRectF m_viewport;
+    int m_level;
+
+    int m_cacheSize;
+    // Might hold more than cacheSize, so that the wanted tiles always fit
+    QCache<quint64, QImage> m_cache;
+    QSet<quint64> m_pending;
+    QSet<quint64> m_failed;
+    // Wanted tiles evicted to make room for other wanted tiles, not
+    // requested again until the wanted tiles change
+    QSet<quint64> m_evicted;
+    // Tiles to draw, coarser levels first
+    QList<quint64> m_display;
+
+    QMutex m_wantedMutex;
+    QSet<quint64> m_wanted;
+    int m_generation;
+
+    QThreadPool m_pool;
+};
+
+#endif /* PYOTHERSIDE_PYTILEDIMAGE_H */
@@ -21,6 +21,7 @@
 #include "qpython.h"
 #include "qpython_priv.h"
 #include "qpython_worker.h"
+#include "qpython_callable.h"
 
 #include "ensure_gil_state.h"
 
@@ -42,46 +43,106 @@
 QPythonPriv *
 QPython::priv = NULL;
 
+QAtomicInt
+QPython::next_request_id(1);
+
+// How long a call may ignore TimeoutError before its worker is abandoned
+static const int STUCK_CALL_GRACE_PERIOD = 1000;
+
 QPython::QPython(QObject *parent, int api_version_major, int api_version_minor)
     : QObject(parent)
     , worker(new QPythonWorker(this))
-    , thread()
+    , thread(NULL)
+    , shared_thread(NULL)
+    , shared_worker(false)
+    , worker_started(false)
     , handlers()
+    , promise_factory()
+    , promises()
+    , default_timeout(0)
+    , timeout_count(0)
+    , deadline_timer()
+    , deadline_clock()
+    , deadline_mutex()
+    , deadlines()
+    , expired()
+    , running_request(0)
+    , running_thread(0)
+    , stuck_timer()
+    , stuck_request(0)
+    , stuck_calls(0)
+    , queue_mutex()
+    , queue()
+    , drain_scheduled(false)
+    , pending_calls(0)
+    , pending_calls_notify(false)
+    , max_pending_calls(0)
+    , overflow_policy(Reject)
+    , inflight()
+    , inflight_signature()
+    , followers()
+    , follower_leader()
+    , pure_functions()
+    , result_cache(1024 * 1024)
+    , cache_pending()
+    , cached_deliveries()
+    , cache_hits(0)
+    , cache_misses(0)
     , api_version_major(api_version_major)
     , api_version_minor(api_version_minor)
     , error_connections(0)
 {
-    if (priv == NULL) {
-        priv = new QPythonPriv;
-    }
-
-    worker->moveToThread(&thread);
+    // Initializes Python right away, unless the plugin already started
+    // initializing it in the background when it was loaded
+    priv = QPythonPriv::start(false);
 
     QObject::connect(priv, SIGNAL(receive(QVariant)),
                      this, SLOT(receive(QVariant)));
+    QObject::connect(priv, SIGNAL(ready()),
+                     this, SIGNAL(readyChanged()));
 
-    QObject::connect(this, SIGNAL(process(QVariant,QVariant,QJSValue *)),
-                     worker, SLOT(process(QVariant,QVariant,QJSValue *)));
-    QObject::connect(worker, SIGNAL(finished(QVariant,QJSValue *)),
-                     this, SLOT(finished(QVariant,QJSValue *)));
+    connectWorker();
 
-    QObject::connect(this, SIGNAL(import(QString,QJSValue *)),
-                     worker, SLOT(import(QString,QJSValue *)));
-    QObject::connect(this, SIGNAL(import_names(QString, QVariant, QJSValue *)),
-                     worker, SLOT(import_names(QString, QVariant, QJSValue *)));
-    QObject::connect(worker, SIGNAL(imported(bool,QJSValue *)),
-                     this, SLOT(imported(bool,QJSValue *)));
+    deadline_clock.start();
+    deadline_timer.setSingleShot(true);
+    QObject::connect(&deadline_timer, SIGNAL(timeout()),
+                     this, SLOT(deadlineExpired()));
 
-    thread.setObjectName("QPythonWorker");
-    thread.start();
+    stuck_timer.setSingleShot(true);
+    QObject::connect(&stuck_timer, SIGNAL(timeout()),
+                     this, SLOT(abandonWorker()));
+
+    // The worker thread is started with the first request (startWorker())
 }
 
 QPython::~QPython()
 {
-    thread.quit();
-    thread.wait();
+    if (shared_thread) {
+        // Other Python objects keep using the thread, so the worker is deleted
+        // there once it's done with the current event (see detach())
+        worker->detach();
+        worker->deleteLater();
+        QPythonWorker::releaseSharedThread(shared_thread);
+    } else {
+        if (thread) {
+            thread->quit();
+            thread->wait();
+            delete thread;
+        }
+
+        delete worker;
+    }
+
+    // Requests that the worker did not get to anymore
+    for (int i=0; i<queue.count(); i++) {
+        delete queue[i].callback;
+    }
+
+    for (int i=0; i<cached_deliveries.count(); i++) {
+        delete cached_deliveries[i].callback;
+    }
 
-    delete worker;
+    qDeleteAll(deadline_callbacks);
 }
 
 void
@@ -103,6 +164,7 @@ QPython::disconnectNotify(const QMetaMethod &signal)
 void
 QPython::addImportPath(QString path)
 {
+    priv->waitForReady();
     ENSURE_GIL_STATE;
 
     // Strip leading "file://" (for use with Qt.resolvedUrl())
@@ -140,11 +202,19 @@ QPython::importNames(QString name, QVariant args, QJSValue callback)
     if (!callback.isNull() && !callback.isUndefined() && callback.isCallable()) {
         cb = new QJSValue(callback);
     }
-    emit import_names(name, args, cb);
+
+    QPythonRequest request = { QPythonRequest::Import, 0, name, args, cb, QString() };
+    enqueueRequest(request);
 }
 
 bool
 QPython::importNames_sync(QString module_name, QVariant args)
+{
+    return importNames_internal(module_name, args, NULL);
+}
+
+bool
+QPython::importNames_internal(QString module_name, QVariant args, QString *errorMessage)
 {
     // The plan is to "from module_name import a, b, c". And args is the list with a, b, c.
     // The module_name can be a packaged module "x.y.z" -- "from x.y.z import a, b, c".
@@ -156,13 +226,14 @@ QPython::importNames_sync(QString module_name, QVariant args)
     QByteArray utf8bytes = module_name.toUtf8();
     const char *moduleName = utf8bytes.constData();
 
+    priv->waitForReady();
     ENSURE_GIL_STATE;
 
     // PyOtherSide API 1.2 behavior: "import x.y.z" -- where the module 'z' is needed
     PyObjectRef module = PyObjectRef(PyImport_ImportModule(moduleName), true);
 
     if (!module) {
-        emitError(QString("Cannot import module: %1 (%2)").arg(module_name).arg(priv->formatExc()));
+        reportError(QString("Cannot import module: %1 (%2)").arg(module_name).arg(priv->formatExc()), errorMessage);
         return false;
     }
 
@@ -185,7 +256,7 @@ QPython::importNames_sync(QString module_name, QVariant args)
         PyObject *res = PyObject_GetAttrString(module.borrow(), utf8bytes);
         result = PyObjectRef(res, true);
         if (!result) {
-            emitError(QString("Object '%1' is not found in '%2': (%3)").arg(obj_name).arg(module_name).arg(priv->formatExc()));
+            reportError(QString("Object '%1' is not found in '%2': (%3)").arg(obj_name).arg(module_name).arg(priv->formatExc()), errorMessage);
             continue;
         }
         PyDict_SetItemString(priv->globals.borrow(), utf8bytes.constData(), result.borrow());
@@ -201,11 +272,19 @@ QPython::importModule(QString name, QJSValue callback)
     if (!callback.isNull() && !callback.isUndefined() && callback.isCallable()) {
         cb = new QJSValue(callback);
     }
-    emit import(name, cb);
+
+    QPythonRequest request = { QPythonRequest::Import, 0, name, QVariant(), cb, QString() };
+    enqueueRequest(request);
 }
 
 bool
 QPython::importModule_sync(QString name)
+{
+    return importModule_internal(name, NULL);
+}
+
+bool
+QPython::importModule_internal(QString name, QString *errorMessage)
 {
     // Lesson learned: name.toUtf8().constData() doesn't work, as the
     // temporary QByteArray will be destroyed after constData() has
@@ -214,6 +293,7 @@ QPython::importModule_sync(QString name)
     QByteArray utf8bytes = name.toUtf8();
     const char *moduleName = utf8bytes.constData();
 
+    priv->waitForReady();
     ENSURE_GIL_STATE;
 
     bool use_api_10 = (api_version_major == 1 && api_version_minor == 0);
@@ -231,7 +311,7 @@ QPython::importModule_sync(QString name)
     }
 
     if (!module) {
-        emitError(QString("Cannot import module: %1 (%2)").arg(name).arg(priv->formatExc()));
+        reportError(QString("Cannot import module: %1 (%2)").arg(name).arg(priv->formatExc()), errorMessage);
         return false;
     }
 
@@ -292,6 +372,7 @@ QPython::setHandler(QString event, QJSValue callback)
 QVariant
 QPython::evaluate(QString expr)
 {
+    priv->waitForReady();
     ENSURE_GIL_STATE;
 
     PyObjectRef o(priv->eval(expr), true);
@@ -319,7 +400,298 @@ QPython::unboxArgList(QVariant &args)
 }
 
 void
-QPython::call(QVariant func, QVariant boxed_args, QJSValue callback)
+QPython::parseCallOptions(const QVariant &options, int *timeout, QString *key)
+{
+    *timeout = default_timeout;
+
+    if (options.userType() == qMetaTypeId<QJSValue>()) {
+        parseCallOptions(options.value<QJSValue>().toVariant(), timeout, key);
+    } else if (static_cast<QMetaType::Type>(options.type()) == QMetaType::QVariantMap) {
+        QVariantMap map = options.toMap();
+        if (map.contains("timeout") && map.value("timeout").toInt() != -1) {
+            *timeout = map.value("timeout").toInt();
+        }
+        *key = map.value("key").toString();
+    } else if (options.isValid() && options.toInt() != -1) {
+        // Just a number: the timeout
+        *timeout = options.toInt();
+    }
+}
+
+// Append an unambiguous representation of v to signature, returns false
+// if v can't be compared by value (e.g. a Python object)
+static bool
+appendSignature(const QVariant &v, QString *signature)
+{
+    switch (static_cast<QMetaType::Type>(v.userType())) {
+        case QMetaType::UnknownType:
+            signature->append("n");
+            return true;
+        case QMetaType::Bool:
+            signature->append(v.toBool() ? "t" : "f");
+            return true;
+        case QMetaType::Int:
+        case QMetaType::UInt:
+        case QMetaType::LongLong:
+        case QMetaType::ULongLong:
+            signature->append('i').append(v.toString()).append(';');
+            return true;
+        case QMetaType::Double:
+        case QMetaType::Float:
+            signature->append('d').append(QString::number(v.toDouble(), 'g', 17)).append(';');
+            return true;
+        case QMetaType::QString:
+            signature->append('s').append(QString::number(v.toString().length()))
+                .append(':').append(v.toString());
+            return true;
+        case QMetaType::QStringList:
+        case QMetaType::QVariantList:
+            {
+                QVariantList list = v.toList();
+                signature->append('[');
+                for (int i=0; i<list.count(); i++) {
+                    if (!appendSignature(list[i], signature)) {
+                        return false;
+                    }
+                }
+                signature->append(']');
+                return true;
+            }
+        case QMetaType::QVariantMap:
+            {
+                // QVariantMap is sorted by key, so the order is stable
+                QVariantMap map = v.toMap();
+                signature->append('{');
+                for (QVariantMap::const_iterator it = map.begin(); it != map.end(); ++it) {
+                    appendSignature(it.key(), signature);
+                    if (!appendSignature(it.value(), signature)) {
+                        return false;
+                    }
+                }
+                signature->append('}');
+                return true;
+            }
+        default:
+            return false;
+    }
+}
+
+QString
+QPython::callSignature(const QVariant &func, const QVariant &args)
+{
+    if (static_cast<QMetaType::Type>(func.type()) != QMetaType::QString) {
+        return QString();
+    }
+
+    QString signature = func.toString();
+    if (!appendSignature(args, &signature)) {
+        return QString();
+    }
+
+    return signature;
+}
+
+bool
+QPython::joinInflight(const QString &signature, QJSValue *callback, int promise_id)
+{
+    if (signature.isNull() || !inflight.contains(signature)) {
+        return false;
+    }
+
+    int leader = inflight.value(signature);
+    Follower follower = { callback, promise_id };
+    followers[leader].append(follower);
+    if (promise_id) {
+        follower_leader.insert(promise_id, leader);
+    }
+
+    return true;
+}
+
+void
+QPython::startInflight(const QString &signature, int id)
+{
+    if (!signature.isNull()) {
+        inflight.insert(signature, id);
+        inflight_signature.insert(id, signature);
+    }
+}
+
+void
+QPython::fanOut(int id, bool ok, const QVariant &value, bool dropped)
+{
+    QString signature = inflight_signature.take(id);
+    if (signature.isNull()) {
+        return;
+    }
+
+    inflight.remove(signature);
+
+    QList<Follower> list = followers.take(id);
+    for (int i=0; i<list.count(); i++) {
+        const Follower &follower = list[i];
+        if (follower.promise_id) {
+            follower_leader.remove(follower.promise_id);
+            if (ok || value.isValid()) {
+                settlePromise(follower.promise_id, ok, value);
+            } else {
+                settlePromise(follower.promise_id, false,
+                        QString("Call to '%1' failed").arg(signature));
+            }
+        }
+
+        if (follower.callback) {
+            if (dropped) {
+                delete follower.callback;
+            } else {
+                callCallback(ok ? value : QVariant(), follower.callback);
+            }
+        }
+    }
+}
+
+// Approximate memory used by a converted result, -1 if it can't be cached
+static int
+resultCost(const QVariant &v)
+{
+    switch (static_cast<QMetaType::Type>(v.userType())) {
+        case QMetaType::UnknownType:
+        case QMetaType::Bool:
+        case QMetaType::Int:
+        case QMetaType::UInt:
+        case QMetaType::LongLong:
+        case QMetaType::ULongLong:
+        case QMetaType::Double:
+        case QMetaType::Float:
+            return sizeof(QVariant);
+        case QMetaType::QString:
+            return sizeof(QVariant) + v.toString().size() * sizeof(QChar);
+        case QMetaType::QByteArray:
+            return sizeof(QVariant) + v.toByteArray().size();
+        case QMetaType::QStringList:
+        case QMetaType::QVariantList:
+            {
+                QVariantList list = v.toList();
+                int cost = sizeof(QVariant);
+                for (int i=0; i<list.count(); i++) {
+                    int item = resultCost(list[i]);
+                    if (item == -1) {
+                        return -1;
+                    }
+                    cost += item;
+                }
+                return cost;
+            }
+        case QMetaType::QVariantMap:
+            {
+                QVariantMap map = v.toMap();
+                int cost = sizeof(QVariant);
+                for (QVariantMap::const_iterator it = map.begin(); it != map.end(); ++it) {
+                    int item = resultCost(it.value());
+                    if (item == -1) {
+                        return -1;
+                    }
+                    cost += item + it.key().size() * sizeof(QChar);
+                }
+                return cost;
+            }
+        default:
+            // Python objects and other references are not cached
+            return -1;
+    }
+}
+
+void
+QPython::setPure(QString func, bool pure)
+{
+    if (pure) {
+        pure_functions.insert(func);
+        return;
+    }
+
+    pure_functions.remove(func);
+
+    // Forget cached results of that function ("name[args...]")
+    QString prefix = func + "[";
+    QList<QString> keys = result_cache.keys();
+    for (int i=0; i<keys.count(); i++) {
+        if (keys[i].startsWith(prefix)) {
+            result_cache.remove(keys[i]);
+        }
+    }
+}
+
+void
+QPython::clearResultCache()
+{
+    result_cache.clear();
+}
+
+void
+QPython::setResultCacheSize(int resultCacheSize)
+{
+    if (resultCacheSize != result_cache.maxCost()) {
+        result_cache.setMaxCost(resultCacheSize);
+        emit resultCacheSizeChanged();
+    }
+}
+
+bool
+QPython::lookupCachedResult(const QVariant &func, const QVariant &args, QString *cache_key, QVariant *result)
+{
+    if (pure_functions.isEmpty() || !pure_functions.contains(func.toString())) {
+        return false;
+    }
+
+    *cache_key = callSignature(func, args);
+    if (cache_key->isNull()) {
+        return false;
+    }
+
+    QVariant *cached = result_cache.object(*cache_key);
+    if (cached) {
+        *result = *cached;
+        cache_hits++;
+        emit cacheHitsChanged();
+        return true;
+    }
+
+    cache_misses++;
+    emit cacheMissesChanged();
+    return false;
+}
+
+void
+QPython::storeCachedResult(int id, bool ok, const QVariant &result)
+{
+    if (cache_pending.isEmpty()) {
+        return;
+    }
+
+    QString cache_key = cache_pending.take(id);
+    if (!ok || cache_key.isNull()) {
+        return;
+    }
+
+    int cost = resultCost(result);
+    if (cost != -1) {
+        result_cache.insert(cache_key, new QVariant(result), cost);
+    }
+}
+
+void
+QPython::deliverCachedResults()
+{
+    QList<CachedDelivery> deliveries = cached_deliveries;
+    cached_deliveries.clear();
+
+    for (int i=0; i<deliveries.count(); i++) {
+        callCallback(deliveries[i].result, deliveries[i].callback);
+    }
+}
+
+void
+QPython::call(QVariant func, QVariant boxed_args, QJSValue callback, QVariant options)
 {
     QJSValue *cb = 0;
     if (!callback.isNull() && !callback.isUndefined() && callback.isCallable()) {
@@ -329,42 +701,754 @@ QPython::call(QVariant func, QVariant boxed_args, QJSValue callback)
     // QML engine and we don't want that to happen from non-GUI thread
     QVariantList unboxed_args = unboxArgList(boxed_args);
 
-    emit process(func, unboxed_args, cb);
+    int timeout;
+    QString key;
+    parseCallOptions(options, &timeout, &key);
+
+    QString cache_key;
+    QVariant cached;
+    if (lookupCachedResult(func, unboxed_args, &cache_key, &cached)) {
+        if (cb) {
+            // Delivered later, like results from the worker
+            CachedDelivery delivery = { cached, cb };
+            cached_deliveries.append(delivery);
+            if (cached_deliveries.count() == 1) {
+                QMetaObject::invokeMethod(this, "deliverCachedResults", Qt::QueuedConnection);
+            }
+        }
+        return;
+    }
+
+    QString signature;
+    if (!key.isEmpty()) {
+        // Keyed calls are idempotent, share the result of an identical call
+        signature = callSignature(func, unboxed_args);
+        if (joinInflight(signature, cb, 0)) {
+            return;
+        }
+    }
+
+    int id = 0;
+    if (timeout > 0 || !key.isEmpty() || !cache_key.isNull()) {
+        id = next_request_id.fetchAndAddOrdered(1);
+    }
+    if (timeout > 0) {
+        startDeadline(id, timeout, func.toString());
+        if (cb) {
+            deadline_callbacks.insert(id, cb);
+            cb = 0;
+        }
+    }
+    startInflight(signature, id);
+    if (!cache_key.isNull()) {
+        cache_pending.insert(id, cache_key);
+    }
+
+    QPythonRequest request = { QPythonRequest::Call, id, func, unboxed_args, cb, key };
+    enqueueRequest(request);
 }
 
-QVariant
-QPython::call_sync(QVariant func, QVariant boxed_args)
+void
+QPython::call_unboxed(QVariant func, const QString &name, QVariantList unboxed_args, QJSValue callback)
 {
-    return call_internal(func, boxed_args, true);
+    QJSValue *cb = 0;
+    if (!callback.isNull() && !callback.isUndefined() && callback.isCallable()) {
+        cb = new QJSValue(callback);
+    }
+
+    int id = 0;
+    if (default_timeout > 0) {
+        id = next_request_id.fetchAndAddOrdered(1);
+        startDeadline(id, default_timeout, name);
+        if (cb) {
+            deadline_callbacks.insert(id, cb);
+            cb = 0;
+        }
+    }
+
+    QPythonRequest request = { QPythonRequest::Call, id, func, unboxed_args, cb, QString() };
+    enqueueRequest(request);
 }
 
-QVariant
-QPython::call_internal(QVariant func, QVariant args, bool unbox)
+void
+QPython::setMaxPendingCalls(int maxPendingCalls)
+{
+    if (maxPendingCalls != max_pending_calls) {
+        QMutexLocker locker(&queue_mutex);
+        max_pending_calls = maxPendingCalls;
+        locker.unlock();
+        emit maxPendingCallsChanged();
+    }
+}
+
+void
+QPython::setOverflowPolicy(OverflowPolicy overflowPolicy)
+{
+    if (overflowPolicy != overflow_policy) {
+        QMutexLocker locker(&queue_mutex);
+        overflow_policy = overflowPolicy;
+        locker.unlock();
+        emit overflowPolicyChanged();
+    }
+}
+
+int
+QPython::pendingCalls() const
+{
+    QMutexLocker locker(&queue_mutex);
+    return pending_calls;
+}
+
+static bool
+isCallRequest(const QPythonRequest &request)
+{
+    return (request.type == QPythonRequest::Call ||
+            request.type == QPythonRequest::CallPromise);
+}
+
+static QString
+coalescingKey(const QPythonRequest &request)
+{
+    // Calls without an explicit key are coalesced by function name
+    if (!request.key.isEmpty()) {
+        return request.key;
+    }
+
+    return request.func.toString();
+}
+
+void
+QPython::enqueueRequest(const QPythonRequest &request)
+{
+    bool is_call = isCallRequest(request);
+    bool full = false;
+    bool accepted = true;
+    bool wake = false;
+    QList<QPythonRequest> dropped;
+
+    {
+        QMutexLocker locker(&queue_mutex);
+
+        if (is_call && !request.key.isEmpty()) {
+            // Only the latest queued call per key is run
+            for (int i=0; i<queue.count(); i++) {
+                if (isCallRequest(queue[i]) && queue[i].key == request.key) {
+                    dropped.append(queue.takeAt(i));
+                    pending_calls--;
+                    break;
+                }
+            }
+        }
+
+        if (is_call && max_pending_calls > 0 && pending_calls >= max_pending_calls) {
+            full = true;
+
+            int victim = -1;
+            if (overflow_policy == Coalesce) {
+                QString key = coalescingKey(request);
+                for (int i=0; !key.isEmpty() && i<queue.count(); i++) {
+                    if (isCallRequest(queue[i]) && coalescingKey(queue[i]) == key) {
+                        victim = i;
+                        break;
+                    }
+                }
+            }
+
+            if (victim == -1 && overflow_policy != Reject) {
+                for (int i=0; i<queue.count(); i++) {
+                    if (isCallRequest(queue[i])) {
+                        victim = i;
+                        break;
+                    }
+                }
+            }
+
+            if (victim == -1) {
+                accepted = false;
+            } else {
+                dropped.append(queue.takeAt(victim));
+                pending_calls--;
+            }
+        }
+
+        if (accepted) {
+            queue.append(request);
+            if (is_call) {
+                pending_calls++;
+            }
+
+            // Only wake up the worker if it isn't draining the queue already
+            wake = !drain_scheduled;
+            drain_scheduled = true;
+        }
+    }
+
+    for (int i=0; i<dropped.count(); i++) {
+        discardRequest(dropped[i], QString("Call to '%1' dropped (superseded or too many pending calls)")
+                .arg(dropped[i].func.toString()), false);
+    }
+
+    if (!accepted) {
+        discardRequest(request, QString("Call to '%1' rejected (too many pending calls)")
+                .arg(request.func.toString()), true);
+    }
+
+    if (full) {
+        emit saturated();
+    }
+
+    if (is_call) {
+        emit pendingCallsChanged();
+    }
+
+    if (wake) {
+        if (!worker_started) {
+            startWorker();
+        }
+        emit requests_queued();
+    }
+}
+
+bool
+QPython::dequeueRequest(QPythonRequest *request)
+{
+    QMutexLocker locker(&queue_mutex);
+
+    if (queue.isEmpty()) {
+        drain_scheduled = false;
+        return false;
+    }
+
+    *request = queue.takeFirst();
+    if (isCallRequest(*request)) {
+        pending_calls--;
+
+        // Called in the worker thread, QML has to be notified in its own
+        // thread; changes until then are reported at once
+        if (!pending_calls_notify) {
+            pending_calls_notify = true;
+            QMetaObject::invokeMethod(this, "notifyPendingCalls", Qt::QueuedConnection);
+        }
+    }
+
+    return true;
+}
+
+void
+QPython::notifyPendingCalls()
+{
+    {
+        QMutexLocker locker(&queue_mutex);
+        pending_calls_notify = false;
+    }
+
+    emit pendingCallsChanged();
+}
+
+void
+QPython::discardRequest(const QPythonRequest &request, const QString &reason, bool report)
+{
+    delete request.callback;
+    delete deadline_callbacks.take(request.id);
+    clearDeadline(request.id);
+
+    fanOut(request.id, false, reason, true);
+    cache_pending.remove(request.id);
+
+    if (request.type == QPythonRequest::CallPromise) {
+        settlePromise(request.id, false, reason);
+    } else if (report) {
+        emitError(reason);
+    }
+}
+
+void
+QPython::setSharedWorker(bool sharedWorker)
+{
+    if (sharedWorker == shared_worker) {
+        return;
+    }
+
+    if (worker_started) {
+        emitError(QString("sharedWorker can only be changed before the first call"));
+        return;
+    }
+
+    shared_worker = sharedWorker;
+    emit sharedWorkerChanged();
+}
+
+void
+QPython::connectWorker()
+{
+    QObject::connect(this, SIGNAL(requests_queued()),
+                     worker, SLOT(drain()));
+
+    QObject::connect(worker, SIGNAL(finished(QVariant,QJSValue *,int,bool)),
+                     this, SLOT(finished(QVariant,QJSValue *,int,bool)));
+    QObject::connect(worker, SIGNAL(imported(bool,QJSValue *)),
+                     this, SLOT(imported(bool,QJSValue *)));
+    QObject::connect(worker, SIGNAL(settled(int,bool,QVariant)),
+                     this, SLOT(settled(int,bool,QVariant)));
+}
+
+void
+QPython::startWorker()
+{
+    worker_started = true;
+
+    if (shared_worker) {
+        shared_thread = QPythonWorker::acquireSharedThread();
+        worker->moveToThread(shared_thread);
+    } else {
+        thread = new QThread;
+        thread->setObjectName("QPythonWorker");
+        worker->moveToThread(thread);
+        thread->start();
+    }
+}
+
+void
+QPython::setTimeout(int timeout)
+{
+    if (timeout != default_timeout) {
+        default_timeout = timeout;
+        emit timeoutChanged();
+    }
+}
+
+void
+QPython::startDeadline(int id, int timeout, const QString &name)
+{
+    {
+        QMutexLocker locker(&deadline_mutex);
+        Deadline deadline = { deadline_clock.elapsed() + timeout, name };
+        deadlines.insert(id, deadline);
+    }
+
+    scheduleDeadlineTimer();
+}
+
+void
+QPython::scheduleDeadlineTimer()
+{
+    qint64 next = -1;
+    {
+        QMutexLocker locker(&deadline_mutex);
+        for (QMap<int,Deadline>::const_iterator it = deadlines.begin(); it != deadlines.end(); ++it) {
+            if (next == -1 || it->expires < next) {
+                next = it->expires;
+            }
+        }
+    }
+
+    if (next == -1) {
+        deadline_timer.stop();
+    } else {
+        deadline_timer.start(qMax(qint64(0), next - deadline_clock.elapsed()));
+    }
+}
+
+void
+QPython::deadlineExpired()
+{
+    QList<QPair<int,QString> > timed_out;
+    {
+        QMutexLocker locker(&deadline_mutex);
+        qint64 now = deadline_clock.elapsed();
+        QMap<int,Deadline>::iterator it = deadlines.begin();
+        while (it != deadlines.end()) {
+            if (it->expires <= now) {
+                timed_out.append(qMakePair(it.key(), it->name));
+                expired.insert(it.key());
+                it = deadlines.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    for (int i=0; i<timed_out.count(); i++) {
+        int id = timed_out[i].first;
+
+        {
+            // The worker clears running_request while holding the GIL,
+            // so the exception cannot end up in an unrelated call
+            ENSURE_GIL_STATE;
+            if (running_request.loadAcquire() == id) {
+                PyThreadState_SetAsyncExc(running_thread, PyExc_TimeoutError);
+
+                // Only seen once the call runs Python code again
+                stuck_request = id;
+                stuck_timer.start(STUCK_CALL_GRACE_PERIOD);
+            }
+        }
+
+        // Finished towards QML right away, even if the worker is stuck in a
+        // blocking C call; its result is discarded once it comes back
+        QString message = QString("Call to '%1' timed out").arg(timed_out[i].second);
+        if (promises.contains(id)) {
+            settlePromise(id, false, message);
+        } else {
+            emitError(message);
+            QJSValue *callback = deadline_callbacks.take(id);
+            if (callback) {
+                callCallback(QVariant(), callback);
+            }
+            fanOut(id, false, QVariant(), false);
+        }
+        timeout_count++;
+
+        // Awaitables returned by the call are still running
+        QMetaObject::invokeMethod(worker, "cancel_awaitable", Qt::QueuedConnection,
+                Q_ARG(int, id));
+    }
+
+    if (!timed_out.isEmpty()) {
+        emit timeoutCountChanged();
+    }
+
+    scheduleDeadlineTimer();
+}
+
+void
+QPython::abandonWorker()
+{
+    int id = stuck_request;
+    stuck_request = 0;
+    if (!id || running_request.loadAcquire() != id) {
+        // Returned in the meantime
+        return;
+    }
+
+    QList<QPythonRequest> dropped;
+    if (!worker->abandon(&dropped)) {
+        return;
+    }
+
+    qWarning("PyOtherSide: Call ignored TimeoutError (blocked in C code?), "
+            "continuing on a new worker thread");
+
+    // The old worker won't end the request anymore
+    running_request.storeRelease(0);
+    clearDeadline(id);
+    cache_pending.remove(id);
+
+    // Deleted in its thread once the call has returned
+    QObject::disconnect(this, 0, worker, 0);
+    QObject::disconnect(worker, 0, this, 0);
+    QObject::connect(worker, SIGNAL(destroyed()),
+                     this, SLOT(stuckCallReturned()));
+    worker->deleteLater();
+
+    if (shared_thread) {
+        QPythonWorker::retireSharedThread(shared_thread);
+        shared_thread = NULL;
+    } else {
+        // Ends after the worker has been deleted
+        QObject::connect(thread, SIGNAL(finished()),
+                         thread, SLOT(deleteLater()));
+        thread->quit();
+        thread = NULL;
+    }
+
+    worker = new QPythonWorker(this);
+    connectWorker();
+    startWorker();
+
+    for (int i=0; i<dropped.count(); i++) {
+        discardRequest(dropped[i], QString("Call dropped (worker thread is blocked)"), true);
+    }
+
+    stuck_calls++;
+    emit stuckCallsChanged();
+
+    // Requests that were queued behind the blocked call
+    emit requests_queued();
+}
+
+void
+QPython::stuckCallReturned()
+{
+    stuck_calls--;
+    emit stuckCallsChanged();
+}
+
+bool
+QPython::beginRequest(int id)
+{
+    if (!id) {
+        return true;
+    }
+
+    QMutexLocker locker(&deadline_mutex);
+    if (expired.remove(id)) {
+        // Timed out while waiting in the queue
+        return false;
+    }
+
+    if (deadlines.contains(id)) {
+        // Called with the GIL held, and the worker keeps its thread state
+        // until endRequest(), so deadlineExpired() always finds it
+        running_thread = PyThread_get_thread_ident();
+        running_request.storeRelease(id);
+    }
+
+    return true;
+}
+
+bool
+QPython::endRequest(int id, bool keepDeadline)
+{
+    if (!id || running_request.loadAcquire() != id) {
+        return false;
+    }
+
+    {
+        ENSURE_GIL_STATE;
+        running_request.storeRelease(0);
+        // Drop a TimeoutError that was raised after the call returned
+        PyThreadState_SetAsyncExc(running_thread, NULL);
+    }
+
+    QMutexLocker locker(&deadline_mutex);
+    if (!keepDeadline) {
+        // Awaitables stay on the clock until they are done (clearDeadline())
+        deadlines.remove(id);
+    }
+    return expired.remove(id);
+}
+
+void
+QPython::clearDeadline(int id)
+{
+    if (!id) {
+        return;
+    }
+
+    QMutexLocker locker(&deadline_mutex);
+    deadlines.remove(id);
+    expired.remove(id);
+}
+
+QJSValue
+QPython::createPromise(int *id)
 {
+    QJSEngine *engine = qjsEngine(this);
+    if (!engine) {
+        emitError(QString("Promises are only available for objects created by a QML engine"));
+        return QJSValue();
+    }
+
+    if (promise_factory.isUndefined()) {
+        // Returns a new promise together with its resolve/reject functions
+        promise_factory = engine->evaluate(
+                "(function () {"
+                "    var d = {};"
+                "    d.promise = new Promise(function (resolve, reject) {"
+                "        d.resolve = resolve;"
+                "        d.reject = reject;"
+                "    });"
+                "    return d;"
+                "})");
+    }
+
+    QJSValue deferred = promise_factory.call();
+    if (!deferred.isObject() || deferred.isError()) {
+        // e.g. Promise is not supported by the JS engine (Qt < 5.12)
+        emitError(QString("Cannot create Promise: %1").arg(deferred.toString()));
+        return QJSValue();
+    }
+
+    *id = next_request_id.fetchAndAddOrdered(1);
+    QJSValue promise = deferred.property("promise");
+    promise.setProperty("__pyotherside_request", *id);
+    promises.insert(*id, deferred);
+
+    return promise;
+}
+
+bool
+QPython::pipelinePromise(QVariant &v, QString *errorMessage)
+{
+    if (v.userType() != qMetaTypeId<QJSValue>()) {
+        return true;
+    }
+
+    QJSValue promise = v.value<QJSValue>();
+    QJSValue request = promise.property("__pyotherside_request");
+    if (!request.isNumber()) {
+        // Not a promise returned from call_promise() and friends
+        return true;
+    }
+
+    if (promise.hasOwnProperty("__pyotherside_value")) {
+        v = promise.property("__pyotherside_value").toVariant();
+        return true;
+    }
+
+    if (promise.hasOwnProperty("__pyotherside_error")) {
+        *errorMessage = QString("Pipelined request failed: %1")
+            .arg(promise.property("__pyotherside_error").property("message").toString());
+        return false;
+    }
+
+    int id = request.toInt();
+    if (!promises.contains(id)) {
+        *errorMessage = QString("Pending promise of another Python object cannot be pipelined");
+        return false;
+    }
+
+    if (follower_leader.contains(id)) {
+        // Shares the result of an identical call, use that one instead
+        id = follower_leader.value(id);
+        if (!promises.contains(id)) {
+            *errorMessage = QString("Promise sharing the result of call() cannot be pipelined");
+            return false;
+        }
+    }
+
+    QPythonPromiseRef ref = { id };
+    v = QVariant::fromValue(ref);
+    return true;
+}
+
+QJSValue
+QPython::call_promise(QVariant func, QVariant boxed_args, QVariant options)
+{
+    int id;
+    QJSValue promise = createPromise(&id);
+    if (promise.isUndefined()) {
+        return promise;
+    }
+
+    QString errorMessage;
+    QVariantList args = boxed_args.toList();
+    bool ok = pipelinePromise(func, &errorMessage);
+    for (int i=0; ok && i<args.count(); i++) {
+        ok = pipelinePromise(args[i], &errorMessage);
+    }
+
+    if (!ok) {
+        settlePromise(id, false, errorMessage);
+        return promise;
+    }
+
+    int timeout;
+    QString key;
+    parseCallOptions(options, &timeout, &key);
+
+    QVariant pipelined_args = args;
+    QVariantList unboxed_args = unboxArgList(pipelined_args);
+
+    QString cache_key;
+    QVariant cached;
+    if (lookupCachedResult(func, unboxed_args, &cache_key, &cached)) {
+        settlePromise(id, true, cached);
+        return promise;
+    }
+    if (!cache_key.isNull()) {
+        cache_pending.insert(id, cache_key);
+    }
+
+    QString signature;
+    if (!key.isEmpty()) {
+        // Keyed calls are idempotent, share the result of an identical call
+        signature = callSignature(func, unboxed_args);
+        if (joinInflight(signature, NULL, id)) {
+            return promise;
+        }
+    }
+
+    if (timeout > 0) {
+        startDeadline(id, timeout, func.toString());
+    }
+    startInflight(signature, id);
+
+    QPythonRequest request = { QPythonRequest::CallPromise, id, func,
+        unboxed_args, NULL, key };
+    enqueueRequest(request);
+    return promise;
+}
+
+QJSValue
+QPython::importModule_promise(QString name)
+{
+    int id;
+    QJSValue promise = createPromise(&id);
+    if (!promise.isUndefined()) {
+        QPythonRequest request = { QPythonRequest::ImportPromise, id, name, QVariant(), NULL, QString() };
+        enqueueRequest(request);
+    }
+    return promise;
+}
+
+QJSValue
+QPython::importNames_promise(QString name, QVariant args)
+{
+    int id;
+    QJSValue promise = createPromise(&id);
+    if (!promise.isUndefined()) {
+        QPythonRequest request = { QPythonRequest::ImportPromise, id, name, args.toList(), NULL, QString() };
+        enqueueRequest(request);
+    }
+    return promise;
+}
+
+QObject *
+QPython::bind(QVariant func)
+{
+    if (!SINCE_API_VERSION(1, 4)) {
+        emitError(QString("Import PyOtherSide 1.4 or newer to use bind()"));
+        return NULL;
+    }
+
+    priv->waitForReady();
     ENSURE_GIL_STATE;
 
     PyObjectRef callable;
     QString name;
 
-    if (SINCE_API_VERSION(1, 4)) {
-        if (static_cast<QMetaType::Type>(func.type()) == QMetaType::QString) {
-            // Using version >= 1.4, but func is a string
-            callable = PyObjectRef(priv->eval(func.toString()), true);
-            name = func.toString();
-        } else {
-            // Try to interpret "func" as a Python object
-            callable = PyObjectRef(convertQVariantToPyObject(func), true);
-            PyObjectRef repr = PyObjectRef(PyObject_Repr(callable.borrow()), true);
+    if (static_cast<QMetaType::Type>(func.type()) == QMetaType::QString) {
+        name = func.toString();
+        callable = PyObjectRef(priv->eval(name), true);
+    } else {
+        callable = PyObjectRef(convertQVariantToPyObject(func), true);
+        if (callable) {
+            PyObjectRef repr(PyObject_Repr(callable.borrow()), true);
             name = convertPyObjectToQVariant(repr.borrow()).toString();
         }
-    } else {
-        // Versions before 1.4 only support func as a string
-        callable = PyObjectRef(priv->eval(func.toString()), true);
-        name = func.toString();
     }
 
     if (!callable) {
-        emitError(QString("Function not found: '%1' (%2)").arg(name).arg(priv->formatExc()));
+        emitError(QString("Function not found: '%1' (%2)").arg(func.toString()).arg(priv->formatExc()));
+        return NULL;
+    }
+
+    if (!PyCallable_Check(callable.borrow())) {
+        emitError(QString("Not a callable: %1").arg(name));
+        return NULL;
+    }
+
+    // The returned object has no parent, so the QML engine takes ownership
+    return new QPythonCallable(this, QVariant::fromValue(callable), name);
+}
+
+QVariant
+QPython::call_sync(QVariant func, QVariant boxed_args)
+{
+    return call_internal(func, boxed_args, true);
+}
+
+QVariant
+QPython::call_internal(QVariant func, QVariant args, bool unbox, QString *errorMessage)
+{
+    priv->waitForReady();
+    ENSURE_GIL_STATE;
+
+    QString name;
+    PyObjectRef callable = lookupCallable(func, &name, errorMessage);
+    if (!callable) {
         return QVariant();
     }
 
@@ -379,13 +1463,47 @@ QPython::call_internal(QVariant func, QVariant args, bool unbox)
     }
 
     QVariant v;
-    QString errorMessage = priv->call(callable.borrow(), name, args_unboxed, &v);
-    if (!errorMessage.isNull()) {
-        emitError(errorMessage);
+    QString callError = priv->call(callable.borrow(), name, args_unboxed, &v);
+    if (!callError.isNull()) {
+        reportError(callError, errorMessage);
     }
     return v;
 }
 
+PyObjectRef
+QPython::lookupCallable(QVariant func, QString *name, QString *errorMessage)
+{
+    // Called with the GIL held
+    PyObjectRef callable;
+
+    if (SINCE_API_VERSION(1, 4)) {
+        if (static_cast<QMetaType::Type>(func.type()) == QMetaType::QString) {
+            // Using version >= 1.4, but func is a string
+            callable = PyObjectRef(priv->evalCached(func.toString()), true);
+            *name = func.toString();
+        } else if (func.userType() == qMetaTypeId<PyObjectRef>()) {
+            // Python object (e.g. from bind()), name is only needed for
+            // error messages and will be looked up lazily by priv->call()
+            callable = func.value<PyObjectRef>();
+        } else {
+            // Try to interpret "func" as a Python object
+            callable = PyObjectRef(convertQVariantToPyObject(func), true);
+        }
+    } else {
+        // Versions before 1.4 only support func as a string
+        callable = PyObjectRef(priv->evalCached(func.toString()), true);
+        *name = func.toString();
+    }
+
+    if (!callable) {
+        reportError(QString("Function not found: '%1' (%2)")
+                .arg(name->isNull() ? func.toString() : *name)
+                .arg(priv->formatExc()), errorMessage);
+    }
+
+    return callable;
+}
+
 QVariant
 QPython::getattr(QVariant obj, QString attr) {
     if (!SINCE_API_VERSION(1, 4)) {
@@ -393,6 +1511,7 @@ QPython::getattr(QVariant obj, QString attr) {
         return QVariant();
     }
 
+    priv->waitForReady();
     ENSURE_GIL_STATE;
 
     PyObjectRef pyobj(convertQVariantToPyObject(obj), true);
@@ -416,7 +1535,25 @@ QPython::getattr(QVariant obj, QString attr) {
 }
 
 void
-QPython::finished(QVariant result, QJSValue *callback)
+QPython::finished(QVariant result, QJSValue *callback, int id, bool ok)
+{
+    clearDeadline(id);
+    storeCachedResult(id, ok, result);
+
+    if (!callback) {
+        // NULL if the deadline has already called it
+        callback = deadline_callbacks.take(id);
+    }
+
+    if (callback) {
+        callCallback(result, callback);
+    }
+
+    fanOut(id, ok, result, false);
+}
+
+void
+QPython::callCallback(const QVariant &result, QJSValue *callback)
 {
     QJSValueList args;
     QJSValue v = GET_JS_ENGINE(*callback)->toScriptValue(result);
@@ -449,6 +1586,53 @@ QPython::imported(bool result, QJSValue *callback)
     delete callback;
 }
 
+void
+QPython::settled(int id, bool ok, QVariant value)
+{
+    // The worker keeps the result for pipelining until we have it
+    QPythonRequest release = { QPythonRequest::Release, id, QVariant(), QVariant(), NULL, QString() };
+    enqueueRequest(release);
+
+    clearDeadline(id);
+    storeCachedResult(id, ok, value);
+    settlePromise(id, ok, value);
+}
+
+void
+QPython::settlePromise(int id, bool ok, QVariant value)
+{
+    QJSValue deferred = promises.take(id);
+    if (deferred.isUndefined()) {
+        return;
+    }
+
+    QJSEngine *engine = qjsEngine(this);
+    QJSValue promise = deferred.property("promise");
+    QJSValue v;
+    if (ok) {
+        // Remembered, so that later call_promise() calls can use it directly
+        v = engine->toScriptValue(value);
+        promise.setProperty("__pyotherside_value", v);
+        deferred.property("resolve").call(QJSValueList() << v);
+    } else {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+        v = engine->newErrorObject(QJSValue::GenericError, value.toString());
+#else
+        v = QJSValue(value.toString());
+#endif
+        promise.setProperty("__pyotherside_error", v);
+        deferred.property("reject").call(QJSValueList() << v);
+    }
+
+    fanOut(id, ok, value, false);
+}
+
+bool
+QPython::isReady() const
+{
+    return priv->isReady();
+}
+
 QString
 QPython::pluginVersion()
 {
@@ -459,6 +1643,7 @@ QString
 QPython::pythonVersion()
 {
     if (SINCE_API_VERSION(1, 5)) {
+        priv->waitForReady();
         ENSURE_GIL_STATE;
 
         PyObjectRef version_info(PySys_GetObject("version_info"));
@@ -480,6 +1665,26 @@ QPython::pythonVersion()
     return QString(PY_VERSION);
 }
 
+bool
+QPython::sinceApiVersion(int major, int minor) const
+{
+    return SINCE_API_VERSION(major, minor);
+}
+
+void
+QPython::reportError(const QString &message, QString *errorMessage)
+{
+    if (errorMessage) {
+        // Collected by the caller (e.g. to reject a promise)
+        if (!errorMessage->isEmpty()) {
+            errorMessage->append('\n');
+        }
+        errorMessage->append(message);
+    } else {
+        emitError(message);
+    }
+}
+
 void
 QPython::emitError(const QString &message)
 {
@@ -20,6 +20,7 @@
 #define PYOTHERSIDE_QPYTHON_H
 
 #include "python_wrap.h"
+#include "pyobject_ref.h"
 
 #include <QVariant>
 #include <QObject>
@@ -29,15 +30,67 @@
 #include <QMap>
 #include <QThread>
 #include <QJSValue>
+#include <QAtomicInt>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QSet>
+#include <QList>
+#include <QCache>
 
 class QPython;
 class QPythonPriv;
 class QPythonWorker;
+class QPythonCallable;
+
+// Request queued for the worker thread (for internal use only)
+struct QPythonRequest {
+    enum Type {
+        Call,
+        CallPromise,
+        Import,
+        ImportPromise,
+        Release,
+    };
+
+    Type type;
+    int id;             // deadline/promise id, 0 if unused
+    QVariant func;      // function, or module name for imports
+    QVariant args;      // arguments, or names for importNames()
+    QJSValue *callback;
+    QString key;        // coalescing key for calls
+};
 
 class QPython : public QObject {
     Q_OBJECT
 
+    Q_PROPERTY(int timeout READ timeout WRITE setTimeout NOTIFY timeoutChanged)
+    Q_PROPERTY(int timeoutCount READ timeoutCount NOTIFY timeoutCountChanged)
+    Q_PROPERTY(int stuckCalls READ stuckCalls NOTIFY stuckCallsChanged)
+    Q_PROPERTY(int maxPendingCalls READ maxPendingCalls WRITE setMaxPendingCalls NOTIFY maxPendingCallsChanged)
+    Q_PROPERTY(OverflowPolicy overflowPolicy READ overflowPolicy WRITE setOverflowPolicy NOTIFY overflowPolicyChanged)
+    Q_PROPERTY(int pendingCalls READ pendingCalls NOTIFY pendingCallsChanged)
+    Q_PROPERTY(int resultCacheSize READ resultCacheSize WRITE setResultCacheSize NOTIFY resultCacheSizeChanged)
+    Q_PROPERTY(int cacheHits READ cacheHits NOTIFY cacheHitsChanged)
+    Q_PROPERTY(int cacheMisses READ cacheMisses NOTIFY cacheMissesChanged)
+    Q_PROPERTY(bool sharedWorker READ sharedWorker WRITE setSharedWorker NOTIFY sharedWorkerChanged)
+    Q_PROPERTY(bool ready READ isReady NOTIFY readyChanged)
+
+    Q_ENUMS(OverflowPolicy)
+
     public:
+        /**
+         * \brief What to do with a new call if maxPendingCalls is reached
+         **/
+        enum OverflowPolicy {
+            /// Do not queue the new call, and report an error
+            Reject,
+            /// Drop the oldest queued call to make room for the new one
+            DropOldest,
+            /// Replace a queued call to the same function, else drop the oldest
+            Coalesce,
+        };
+
         /**
          * \brief Create a new Python instance
          *
@@ -263,14 +316,32 @@ class QPython : public QObject {
          * }
          * \endcode
          *
+         * \a options can be a number (the timeout) or an object with
+         * these optional fields:
+         *
+         *  - \c timeout: If the call does not finish within this number of
+         *    milliseconds (0 for no limit, -1 or missing for the value of
+         *    the timeout property), error() is emitted and the callback is
+         *    called with \c undefined right away; a TimeoutError is raised
+         *    in the Python code (or its awaitable is cancelled), and its
+         *    result is discarded. A call blocked in C code (e.g. waiting
+         *    in \c recv()) only sees the TimeoutError once it returns;
+         *    see stuckCalls.
+         *  - \c key: Marks the call as idempotent. A queued call with the
+         *    same key is dropped in favor of this one, and if an identical
+         *    call (same function and arguments) is already queued or
+         *    running, its result is shared instead of calling again.
+         *
          * \arg func The Python function to call (string or Python callable)
          * \arg args A list of arguments, or \c [] for no arguments
          * \arg callback A callback that receives the function call result
+         * \arg options Timeout in milliseconds, or object with call options
          **/
         Q_INVOKABLE void
         call(QVariant func,
              QVariant args=QVariantList(),
-             QJSValue callback=QJSValue());
+             QJSValue callback=QJSValue(),
+             QVariant options=QVariant());
 
 
         /**
@@ -301,7 +372,111 @@ class QPython : public QObject {
 
         QVariant
         call_internal(QVariant func, QVariant boxed_args=QVariantList(),
-            bool unbox=true);
+            bool unbox=true, QString *errorMessage=NULL);
+
+        // name is used in timeout errors, as func may be a Python object
+        void
+        call_unboxed(QVariant func, const QString &name,
+            QVariantList unboxed_args, QJSValue callback=QJSValue());
+
+        /**
+         * \brief Asynchronously call a Python function, returning a Promise
+         *
+         * Like call(), but instead of taking a callback, a JavaScript
+         * Promise is returned that will be resolved with the result of
+         * the function call, or rejected with the error message:
+         *
+         * \code
+         * Python {
+         *     Component.onCompleted: {
+         *         importModule_promise('os');
+         *         call_promise('os.getcwd').then(function (result) {
+         *             console.log('Working directory: ' + result);
+         *         });
+         *     }
+         * }
+         * \endcode
+         *
+         * Calls are executed in the order in which they were issued, so
+         * the call does not need to wait for the import to finish.
+         *
+         * Unresolved promises returned by this function can be used as
+         * \a func or directly in \a args of another call_promise() on the
+         * same object. The worker thread then passes the result along
+         * without a round-trip through the QML thread:
+         *
+         * \code
+         * var items = call_promise('db.query', ['SELECT ...']);
+         * call_promise('db.render', [items]).then(function (html) { ... });
+         * \endcode
+         *
+         * \arg func The Python function to call (string or Python callable)
+         * \arg args A list of arguments, or \c [] for no arguments
+         * \arg options Timeout in milliseconds, or object with call options
+         *                (see call())
+         * \result A Promise for the function call result
+         **/
+        Q_INVOKABLE QJSValue
+        call_promise(QVariant func, QVariant args=QVariantList(),
+                QVariant options=QVariant());
+
+        /**
+         * \brief Asynchronously import a Python module, returning a Promise
+         *
+         * Like importModule(), but returns a JavaScript Promise that is
+         * resolved with \c true once the module is imported, or rejected
+         * with the error message if the import fails.
+         *
+         * \arg name The name of the Python module to import
+         * \result A Promise for the import
+         **/
+        Q_INVOKABLE QJSValue
+        importModule_promise(QString name);
+
+        /**
+         * \brief Asynchronously import objects from a module, returning a Promise
+         *
+         * Like importNames(), but returns a JavaScript Promise that is
+         * resolved with \c true once all names are imported, or rejected
+         * with the error message if any of the imports fails.
+         *
+         * \arg name The name of the Python module to import from
+         * \arg args The name of Python objects to import from the module
+         * \result A Promise for the import
+         **/
+        Q_INVOKABLE QJSValue
+        importNames_promise(QString name, QVariant args);
+
+        /**
+         * \brief Resolve a Python callable once for repeated calls
+         *
+         * Look up \a func (like call() does) and return an object holding
+         * the resolved callable. Calls through that object skip the name
+         * lookup, which makes it a good fit for calls that happen very often
+         * (e.g. once per frame from an animation):
+         *
+         * \code
+         * Python {
+         *     property var setTime: null
+         *
+         *     Component.onCompleted: {
+         *         importModule_sync('renderer');
+         *         setTime = bind('renderer.set_time');
+         *     }
+         * }
+         *
+         * // Elsewhere, e.g. in onTChanged of an animated property
+         * setTime.invoke([t]);
+         * \endcode
+         *
+         * The returned object has the methods \c invoke(args, callback)
+         * and \c invokeSync(args), which behave like call() and call_sync().
+         *
+         * \arg func The Python function to bind (string or Python callable)
+         * \result The bound callable, or \c null if \a func was not found
+         **/
+        Q_INVOKABLE QObject *
+        bind(QVariant func);
 
         /**
          * \brief Get an attribute value of a Python object synchronously
@@ -341,6 +516,130 @@ class QPython : public QObject {
         Q_INVOKABLE QString
         pythonVersion();
 
+        /**
+         * \brief Default deadline for call() and call_promise()
+         *
+         * Calls that take longer than this number of milliseconds are
+         * aborted by raising TimeoutError in the worker thread. The
+         * default value of 0 means that calls never time out.
+         **/
+        int timeout() const { return default_timeout; }
+        void setTimeout(int timeout);
+
+        /**
+         * \brief Number of calls that were aborted because of a timeout
+         **/
+        int timeoutCount() const { return timeout_count; }
+
+        /**
+         * \brief Number of timed out calls that are still blocked
+         *
+         * TimeoutError can only be raised while Python code runs. If a
+         * call is blocked in C code (e.g. a socket read without timeout)
+         * and has not returned a second after its deadline, its worker
+         * thread is abandoned: queued calls continue on a new thread, and
+         * awaitables of the old thread are dropped. The blocked call
+         * keeps its thread until it returns, which then ends, and this
+         * number goes down again. With sharedWorker, other Python objects
+         * on that thread still have to wait for it, but no new objects
+         * are assigned to it.
+         **/
+        int stuckCalls() const { return stuck_calls; }
+
+        /**
+         * \brief Maximum number of queued calls (0 for no limit)
+         *
+         * Calls that have been issued with call(), call_promise() or a
+         * bound function, but did not start running yet, count towards
+         * this limit. If it is reached, the overflowPolicy decides what
+         * happens to the new call, and saturated() is emitted.
+         **/
+        int maxPendingCalls() const { return max_pending_calls; }
+        void setMaxPendingCalls(int maxPendingCalls);
+
+        OverflowPolicy overflowPolicy() const { return overflow_policy; }
+        void setOverflowPolicy(OverflowPolicy overflowPolicy);
+
+        /**
+         * \brief Number of calls that are queued, but not yet running
+         **/
+        int pendingCalls() const;
+
+        /**
+         * \brief Mark a Python function as pure (or not)
+         *
+         * Results of calls to pure functions are cached, keyed by the
+         * function name and the arguments. Later call() and call_promise()
+         * invocations with the same arguments are answered from the cache
+         * without going to the worker thread. Only results that can be
+         * converted to plain data (no Python objects) are cached.
+         *
+         * \code
+         * Python {
+         *     Component.onCompleted: {
+         *         importModule_sync('units');
+         *         setPure('units.convert');
+         *     }
+         * }
+         * \endcode
+         *
+         * \arg func The name of the Python function
+         * \arg pure \c false to stop caching (cached results are dropped)
+         **/
+        Q_INVOKABLE void
+        setPure(QString func, bool pure=true);
+
+        /**
+         * \brief Drop all cached results of pure functions
+         **/
+        Q_INVOKABLE void
+        clearResultCache();
+
+        /**
+         * \brief Approximate maximum size of the result cache in bytes
+         *
+         * The least recently used results are dropped when the limit is
+         * reached. The default is 1 MiB.
+         **/
+        int resultCacheSize() const { return int(result_cache.maxCost()); }
+        void setResultCacheSize(int resultCacheSize);
+
+        /**
+         * \brief Number of calls to pure functions answered from the cache
+         **/
+        int cacheHits() const { return cache_hits; }
+
+        /**
+         * \brief Number of calls to pure functions that were not cached
+         **/
+        int cacheMisses() const { return cache_misses; }
+
+        /**
+         * \brief Run calls on a worker thread shared with other objects
+         *
+         * By default, each Python object has its own worker thread. If
+         * this is \c true, calls are run on one of a small number of
+         * worker threads shared by all Python objects with sharedWorker
+         * set (the number can be set with the environment variable
+         * \c PYOTHERSIDE_WORKER_THREADS, default 2). Objects sharing a
+         * thread take turns, one call at a time, and calls of the same
+         * object are still run in order.
+         *
+         * This can only be changed before the first asynchronous call.
+         **/
+        bool sharedWorker() const { return shared_worker; }
+        void setSharedWorker(bool sharedWorker);
+
+        /**
+         * \brief Whether the Python interpreter has been initialized
+         *
+         * When loaded as QML plugin, Python is initialized on a separate
+         * thread, so the first frame can be shown right away. Asynchronous
+         * calls and imports issued before that are queued, synchronous ones
+         * (and addImportPath()) block until the interpreter is ready.
+         **/
+        bool isReady() const;
+
     signals:
         /**
          * \brief Default event handler for \c pyotherside.send()
@@ -364,32 +663,157 @@ class QPython : public QObject {
          **/
         void error(QString traceback);
 
+        void timeoutChanged();
+        void timeoutCountChanged();
+        void stuckCallsChanged();
+        void maxPendingCallsChanged();
+        void overflowPolicyChanged();
+        void pendingCallsChanged();
+        void resultCacheSizeChanged();
+        void cacheHitsChanged();
+        void cacheMissesChanged();
+        void sharedWorkerChanged();
+        void readyChanged();
+
+        /**
+         * \brief The queue of pending calls is full
+         *
+         * Emitted when a call is issued while maxPendingCalls calls are
+         * already queued. The UI can use this to throttle itself.
+         **/
+        void saturated();
+
         /* For internal use only */
-        void process(QVariant func, QVariant unboxed_args, QJSValue *callback);
-        void import(QString name, QJSValue *callback);
-        void import_names(QString name, QVariant args, QJSValue *callback);
+        void requests_queued();
 
     private slots:
         void receive(QVariant data);
 
-        void finished(QVariant result, QJSValue *callback);
+        void finished(QVariant result, QJSValue *callback, int id, bool ok);
         void imported(bool result, QJSValue *callback);
+        void settled(int id, bool ok, QVariant value);
+        void deadlineExpired();
+        void abandonWorker();
+        void stuckCallReturned();
+        void deliverCachedResults();
+        void notifyPendingCalls();
 
         void connectNotify(const QMetaMethod &signal);
         void disconnectNotify(const QMetaMethod &signal);
 
     private:
+        friend class QPythonCallable;
+        friend class QPythonWorker;
+
         QVariantList unboxArgList(QVariant &args);
+        PyObjectRef lookupCallable(QVariant func, QString *name, QString *errorMessage);
+
+        bool importModule_internal(QString name, QString *errorMessage);
+        bool importNames_internal(QString name, QVariant args, QString *errorMessage);
+
+        QJSValue createPromise(int *id);
+        bool pipelinePromise(QVariant &v, QString *errorMessage);
+
+        void callCallback(const QVariant &result, QJSValue *callback);
+        void parseCallOptions(const QVariant &options, int *timeout, QString *key);
+
+        QString callSignature(const QVariant &func, const QVariant &args);
+        bool joinInflight(const QString &signature, QJSValue *callback, int promise_id);
+        void startInflight(const QString &signature, int id);
+        void fanOut(int id, bool ok, const QVariant &value, bool dropped);
+        void settlePromise(int id, bool ok, QVariant value);
+
+        bool lookupCachedResult(const QVariant &func, const QVariant &args,
+                QString *cache_key, QVariant *result);
+        void storeCachedResult(int id, bool ok, const QVariant &result);
+
+        void enqueueRequest(const QPythonRequest &request);
+        bool dequeueRequest(QPythonRequest *request);
+        void discardRequest(const QPythonRequest &request, const QString &reason, bool report);
+
+        void startDeadline(int id, int timeout, const QString &name);
+        void scheduleDeadlineTimer();
+        bool beginRequest(int id);
+        bool endRequest(int id, bool keepDeadline=false);
+        void clearDeadline(int id);
 
         static QPythonPriv *priv;
 
+        void connectWorker();
+        void startWorker();
+
         QPythonWorker *worker;
-        QThread thread;
+        QThread *thread;
+        QThread *shared_thread;
+        bool shared_worker;
+        bool worker_started;
         QMap<QString,QJSValue> handlers;
 
+        // Pending promises from call_promise() and friends, by request id
+        QJSValue promise_factory;
+        QMap<int,QJSValue> promises;
+        static QAtomicInt next_request_id;
+
+        // Deadlines of calls with a timeout, shared with the worker thread
+        struct Deadline {
+            qint64 expires;
+            QString name;
+        };
+        int default_timeout;
+        int timeout_count;
+        QTimer deadline_timer;
+        QElapsedTimer deadline_clock;
+        QMutex deadline_mutex;
+        QMap<int,Deadline> deadlines;
+        QSet<int> expired;
+        // Callbacks of calls with a deadline, called from whichever comes
+        // first: the result or the deadline (QML thread only)
+        QMap<int,QJSValue *> deadline_callbacks;
+        QAtomicInt running_request;
+        unsigned long running_thread;
+        // Running call that timed out, abandoned if it doesn't return
+        QTimer stuck_timer;
+        int stuck_request;
+        int stuck_calls;
+
+        // Requests for the worker thread, in the order they were issued
+        mutable QMutex queue_mutex;
+        QList<QPythonRequest> queue;
+        bool drain_scheduled;
+        int pending_calls;
+        bool pending_calls_notify;
+        int max_pending_calls;
+        OverflowPolicy overflow_policy;
+
+        // Keyed calls that are queued or running, by function and arguments,
+        // and the callbacks/promises of identical calls waiting for them
+        struct Follower {
+            QJSValue *callback;
+            int promise_id;
+        };
+        QMap<QString,int> inflight;
+        QMap<int,QString> inflight_signature;
+        QMap<int,QList<Follower> > followers;
+        QMap<int,int> follower_leader;
+
+        // Results of pure functions, by function name and arguments
+        struct CachedDelivery {
+            QVariant result;
+            QJSValue *callback;
+        };
+        QSet<QString> pure_functions;
+        QCache<QString,QVariant> result_cache;
+        QMap<int,QString> cache_pending;
+        QList<CachedDelivery> cached_deliveries;
+        int cache_hits;
+        int cache_misses;
+
         int api_version_major;
         int api_version_minor;
 
+        bool sinceApiVersion(int major, int minor) const;
+
+        void reportError(const QString &message, QString *errorMessage);
         void emitError(const QString &message);
         int error_connections;
 };
@@ -439,4 +863,13 @@ public:
     }
 };
 
+class QPython16 : public QPython {
+Q_OBJECT
+public:
+    QPython16(QObject *parent=0)
+        : QPython(parent, 1, 6)
+    {
+    }
+};
+
 #endif /* PYOTHERSIDE_QPYTHON_H */
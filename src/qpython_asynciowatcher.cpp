@@ -0,0 +1,124 @@
+/**
+ * PyOtherSide: Asynchronous Python 3 Bindings for Qt 5 and Qt 6
+ * Copyright (c) 2011, 2013-2025, Thomas Perl <m@thp.io>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ **/
+
+#include "qpython_asynciowatcher.h"
+#include "pyobject_ref.h"
+
+// selectors.EVENT_READ and selectors.EVENT_WRITE
+static const int EVENT_READ = 1;
+static const int EVENT_WRITE = 2;
+
+QPythonAsyncioWatcher::QPythonAsyncioWatcher(QObject *parent)
+    : QObject(parent)
+    , timer(new QTimer(this))
+    , readers()
+    , writers()
+{
+    timer->setSingleShot(true);
+    QObject::connect(timer, SIGNAL(timeout()), this, SIGNAL(activated()));
+}
+
+PyObject *
+QPythonAsyncioWatcher::update(PyObject *result)
+{
+    int timeout = -1;
+    PyObject *fds = NULL;
+    PyObject *finished = NULL;
+    if (!PyArg_ParseTuple(result, "iOO", &timeout, &fds, &finished)) {
+        return NULL;
+    }
+
+    QMap<int,int> events;
+    PyObjectRef iter(PyObject_GetIter(fds), true);
+    PyObjectRef item;
+    while (iter && (item = PyObjectRef(PyIter_Next(iter.borrow()), true))) {
+        int fd = -1;
+        int mask = 0;
+        if (!PyArg_ParseTuple(item.borrow(), "ii", &fd, &mask)) {
+            return NULL;
+        }
+        events[fd] |= mask;
+    }
+
+    if (!iter || PyErr_Occurred()) {
+        return NULL;
+    }
+
+    watch(readers, events, EVENT_READ, QSocketNotifier::Read);
+    watch(writers, events, EVENT_WRITE, QSocketNotifier::Write);
+
+    if (timeout >= 0) {
+        timer->start(timeout);
+    } else {
+        // Only woken up by I/O (or wakeUp())
+        timer->stop();
+    }
+
+    return finished;
+}
+
+void
+QPythonAsyncioWatcher::wakeUp(int msec)
+{
+    timer->start(msec);
+}
+
+void
+QPythonAsyncioWatcher::watch(QMap<int,QSocketNotifier *> &notifiers, const QMap<int,int> &fds,
+        int event, QSocketNotifier::Type type)
+{
+    QMap<int,QSocketNotifier *>::iterator it = notifiers.begin();
+    while (it != notifiers.end()) {
+        if (!(fds.value(it.key()) & event)) {
+            delete it.value();
+            it = notifiers.erase(it);
+        } else {
+            it.value()->setEnabled(true);
+            ++it;
+        }
+    }
+
+    for (QMap<int,int>::const_iterator fd = fds.begin(); fd != fds.end(); ++fd) {
+        if ((fd.value() & event) && !notifiers.contains(fd.key())) {
+            QSocketNotifier *notifier = new QSocketNotifier(fd.key(), type, this);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+            QObject::connect(notifier, SIGNAL(activated(QSocketDescriptor, QSocketNotifier::Type)),
+                             this, SLOT(notifierActivated()));
+#else
+            QObject::connect(notifier, SIGNAL(activated(int)),
+                             this, SLOT(notifierActivated()));
+#endif
+            notifiers.insert(fd.key(), notifier);
+        }
+    }
+}
+
+void
+QPythonAsyncioWatcher::notifierActivated()
+{
+    // Notifiers keep firing until step() has handled the I/O, so they are
+    // disabled until the next update()
+    QMap<int,QSocketNotifier *>::iterator it;
+    for (it = readers.begin(); it != readers.end(); ++it) {
+        it.value()->setEnabled(false);
+    }
+    for (it = writers.begin(); it != writers.end(); ++it) {
+        it.value()->setEnabled(false);
+    }
+
+    timer->start(0);
+}
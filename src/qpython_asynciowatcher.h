@@ -0,0 +1,62 @@
+/**
+ * PyOtherSide: Asynchronous Python 3 Bindings for Qt 5 and Qt 6
+ * Copyright (c) 2011, 2013-2025, Thomas Perl <m@thp.io>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ **/
+
+#ifndef PYOTHERSIDE_QPYTHON_ASYNCIOWATCHER_H
+#define PYOTHERSIDE_QPYTHON_ASYNCIOWATCHER_H
+
+#include "python_wrap.h"
+
+#include <QObject>
+#include <QTimer>
+#include <QMap>
+#include <QSocketNotifier>
+
+// Lets the Qt event loop of a thread wait for an asyncio Runner (see
+// asyncio_runner.py): activated() is emitted when the next timer of the
+// asyncio event loop is due or one of its file descriptors is ready, which
+// is when Runner.step() has to be called again.
+class QPythonAsyncioWatcher : public QObject {
+    Q_OBJECT
+
+public:
+    QPythonAsyncioWatcher(QObject *parent=0);
+
+    // Watch the timeout and file descriptors from the result of step() and
+    // return its list of finished awaitables (borrowed reference), or NULL
+    // with a Python exception set; requires the GIL
+    PyObject *update(PyObject *result);
+
+    // Emit activated() after msec milliseconds, e.g. after new awaitables
+    // have been scheduled or cancelled
+    void wakeUp(int msec=0);
+
+signals:
+    void activated();
+
+private slots:
+    void notifierActivated();
+
+private:
+    void watch(QMap<int,QSocketNotifier *> &notifiers, const QMap<int,int> &fds,
+            int event, QSocketNotifier::Type type);
+
+    QTimer *timer;
+    QMap<int,QSocketNotifier *> readers;
+    QMap<int,QSocketNotifier *> writers;
+};
+
+#endif /* PYOTHERSIDE_QPYTHON_ASYNCIOWATCHER_H */
@@ -0,0 +1,89 @@
+
+/**
+ * PyOtherSide: Asynchronous Python 3 Bindings for Qt 5 and Qt 6
+ * Copyright (c) 2011, 2013-2025, Thomas Perl <m@thp.io>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ **/
+
+#include "qpython_callable.h"
+#include "qpython.h"
+
+
+QPythonCallable::QPythonCallable(QPython *qpython, QVariant callable, QString name)
+    : QObject()
+    , m_qpython(qpython)
+    , m_callable(callable)
+    , m_name(name)
+{
+}
+
+QPythonCallable::~QPythonCallable()
+{
+}
+
+bool
+QPythonCallable::convertArgs(const QJSValue &args, QVariantList *result)
+{
+    if (args.isUndefined() || args.isNull()) {
+        return true;
+    }
+
+    if (!args.isArray()) {
+        m_qpython->emitError(QString("Not a parameter list in call to %1: %2")
+                .arg(m_name).arg(args.toString()));
+        return false;
+    }
+
+    // Unbox the JS array element by element on the GUI thread, so that we
+    // don't have to go through a boxed QVariant list and unboxArgList()
+    int length = args.property("length").toInt();
+    result->reserve(length);
+    for (int i=0; i<length; i++) {
+        result->append(args.property(i).toVariant());
+    }
+
+    return true;
+}
+
+void
+QPythonCallable::invoke(QJSValue args, QJSValue callback)
+{
+    if (!m_qpython) {
+        qWarning("Cannot invoke %s: Python object was destroyed",
+                m_name.toUtf8().constData());
+        return;
+    }
+
+    QVariantList unboxed_args;
+    if (convertArgs(args, &unboxed_args)) {
+        m_qpython->call_unboxed(m_callable, m_name, unboxed_args, callback);
+    }
+}
+
+QVariant
+QPythonCallable::invokeSync(QJSValue args)
+{
+    if (!m_qpython) {
+        qWarning("Cannot invoke %s: Python object was destroyed",
+                m_name.toUtf8().constData());
+        return QVariant();
+    }
+
+    QVariantList unboxed_args;
+    if (!convertArgs(args, &unboxed_args)) {
+        return QVariant();
+    }
+
+    return m_qpython->call_internal(m_callable, unboxed_args, false);
+}
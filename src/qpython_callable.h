@@ -0,0 +1,95 @@
+
+/**
+ * PyOtherSide: Asynchronous Python 3 Bindings for Qt 5 and Qt 6
+ * Copyright (c) 2011, 2013-2025, Thomas Perl <m@thp.io>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ **/
+
+#ifndef PYOTHERSIDE_QPYTHON_CALLABLE_H
+#define PYOTHERSIDE_QPYTHON_CALLABLE_H
+
+#include <QObject>
+#include <QString>
+#include <QVariant>
+#include <QJSValue>
+#include <QPointer>
+
+class QPython;
+
+class QPythonCallable : public QObject {
+    Q_OBJECT
+    Q_PROPERTY(QString name READ name CONSTANT)
+
+    public:
+        /**
+         * \brief Python callable bound to a QPython instance
+         *
+         * Instances are created by QPython::bind(), the callable has
+         * already been resolved, so calls skip name lookup entirely.
+         *
+         * \arg qpython The QPython instance used for calling
+         * \arg callable The resolved Python callable (boxed PyObjectRef)
+         * \arg name Name of the callable (for error messages)
+         **/
+        QPythonCallable(QPython *qpython, QVariant callable, QString name);
+        virtual ~QPythonCallable();
+
+        /**
+         * \brief Asynchronously call the bound Python callable
+         *
+         * This is the equivalent of QPython::call() with the bound
+         * callable as first parameter:
+         *
+         * \code
+         * Python {
+         *     property var getRow: null
+         *
+         *     Component.onCompleted: {
+         *         importModule_sync('model');
+         *         getRow = bind('model.get_row');
+         *         getRow.invoke([42], function (row) {
+         *             console.log('Row 42: ' + row);
+         *         });
+         *     }
+         * }
+         * \endcode
+         *
+         * \arg args A JS array of arguments, or \c [] for no arguments
+         * \arg callback A callback that receives the function call result
+         **/
+        Q_INVOKABLE void
+        invoke(QJSValue args=QJSValue(), QJSValue callback=QJSValue());
+
+        /**
+         * \brief Synchronously call the bound Python callable
+         *
+         * This is the synchronous variant of invoke().
+         *
+         * \arg args A JS array of arguments, or \c [] for no arguments
+         * \result The return value of the Python call as Qt data type
+         **/
+        Q_INVOKABLE QVariant
+        invokeSync(QJSValue args=QJSValue());
+
+        QString name() const { return m_name; }
+
+    private:
+        bool convertArgs(const QJSValue &args, QVariantList *result);
+
+        QPointer<QPython> m_qpython;
+        QVariant m_callable;
+        QString m_name;
+};
+
+#endif /* PYOTHERSIDE_QPYTHON_CALLABLE_H */
@@ -0,0 +1,194 @@
+/**
+ * PyOtherSide: Asynchronous Python 3 Bindings for Qt 5 and Qt 6
+ * Copyright (c) 2011, 2013-2025, Thomas Perl <m@thp.io>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ **/
+
+#include "qpython_framestream.h"
+
+#include <QMap>
+#include <QMutexLocker>
+
+
+static QMutex rings_mutex;
+static QMap<QString, QWeakPointer<QPythonFrameRing> > rings;
+
+static int
+bytes_per_pixel(QImage::Format format)
+{
+    switch (format) {
+        case QImage::Format_RGB888:
+            return 3;
+        default:
+            return 4;
+    }
+}
+
+QPythonFrameRing::QPythonFrameRing(const QSize &size, QImage::Format format, int count)
+    : QObject()
+    , m_size(size)
+    , m_format(format)
+    // 32-bit aligned rows, like QImage
+    , m_bytesPerLine((size.width() * bytes_per_pixel(format) + 3) / 4 * 4)
+    , m_mutex()
+    , m_buffers()
+    , m_bits()
+    , m_states()
+    , m_presented(0)
+    , m_dropped(0)
+    , m_notified(false)
+{
+    for (int i=0; i<count; i++) {
+        m_buffers << QByteArray(byteCount(), '\0');
+        // Never shared, so data() doesn't detach later on
+        m_bits << (uchar *)m_buffers[i].data();
+        m_states << Free;
+    }
+}
+
+QPythonFrameRing::~QPythonFrameRing()
+{
+}
+
+void
+QPythonFrameRing::registerRing(const QString &name, QSharedPointer<QPythonFrameRing> ring)
+{
+    QMutexLocker lock(&rings_mutex);
+    rings[name] = ring;
+}
+
+void
+QPythonFrameRing::unregisterRing(const QString &name, QPythonFrameRing *ring)
+{
+    QMutexLocker lock(&rings_mutex);
+
+    // Another stream might have taken over the name in the meantime
+    QSharedPointer<QPythonFrameRing> current = rings.value(name).toStrongRef();
+    if (!current || current.data() == ring) {
+        rings.remove(name);
+    }
+}
+
+QSharedPointer<QPythonFrameRing>
+QPythonFrameRing::find(const QString &name)
+{
+    QMutexLocker lock(&rings_mutex);
+    return rings.value(name).toStrongRef();
+}
+
+int
+QPythonFrameRing::acquire()
+{
+    QMutexLocker lock(&m_mutex);
+
+    for (int i=0; i<m_states.count(); i++) {
+        if (m_states[i] == Free) {
+            m_states[i] = Writing;
+            return i;
+        }
+    }
+
+    // Reuse the committed frame that hasn't been shown yet (double buffering)
+    for (int i=0; i<m_states.count(); i++) {
+        if (m_states[i] == Ready) {
+            m_states[i] = Writing;
+            m_dropped++;
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+bool
+QPythonFrameRing::commit(int index)
+{
+    {
+        QMutexLocker lock(&m_mutex);
+
+        if (index < 0 || index >= m_states.count() || m_states[index] != Writing) {
+            return false;
+        }
+
+        // Only the newest complete frame is kept for presenting
+        for (int i=0; i<m_states.count(); i++) {
+            if (m_states[i] == Ready) {
+                m_states[i] = Free;
+                m_dropped++;
+            }
+        }
+
+        m_states[index] = Ready;
+
+        if (m_notified) {
+            return true;
+        }
+        m_notified = true;
+    }
+
+    emit frameCommitted();
+    return true;
+}
+
+void
+QPythonFrameRing::release(int index)
+{
+    QMutexLocker lock(&m_mutex);
+
+    if (index >= 0 && index < m_states.count() && m_states[index] == Writing) {
+        m_states[index] = Free;
+    }
+}
+
+QImage
+QPythonFrameRing::takeNewest()
+{
+    QMutexLocker lock(&m_mutex);
+    m_notified = false;
+
+    // There is at most one committed frame, see commit()
+    int newest = m_states.indexOf(Ready);
+
+    if (newest == -1) {
+        return QImage();
+    }
+
+    // The previously presented frame has been replaced and can be reused
+    for (int i=0; i<m_states.count(); i++) {
+        if (m_states[i] == Presented) {
+            m_states[i] = Free;
+        }
+    }
+
+    m_states[newest] = Presented;
+    m_presented++;
+
+    // Read-only wrapper, so that the buffer is not detached (copied)
+    return QImage((const uchar *)m_bits[newest], m_size.width(), m_size.height(),
+            m_bytesPerLine, m_format);
+}
+
+int
+QPythonFrameRing::presented()
+{
+    QMutexLocker lock(&m_mutex);
+    return m_presented;
+}
+
+int
+QPythonFrameRing::dropped()
+{
+    QMutexLocker lock(&m_mutex);
+    return m_dropped;
+}
@@ -0,0 +1,91 @@
+/**
+ * PyOtherSide: Asynchronous Python 3 Bindings for Qt 5 and Qt 6
+ * Copyright (c) 2011, 2013-2025, Thomas Perl <m@thp.io>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ **/
+
+#ifndef PYOTHERSIDE_QPYTHON_FRAMESTREAM_H
+#define PYOTHERSIDE_QPYTHON_FRAMESTREAM_H
+
+#include <QObject>
+#include <QImage>
+#include <QSize>
+#include <QList>
+#include <QByteArray>
+#include <QString>
+#include <QMutex>
+#include <QSharedPointer>
+
+// Ring of preallocated frame buffers shared between Python (which fills
+// them, see pyotherside.acquire_frame()) and a PyFrameStream (which shows
+// the newest committed one). Only needs QtGui, so that it can be used from
+// qpython_priv.cpp.
+class QPythonFrameRing : public QObject {
+    Q_OBJECT
+
+public:
+    QPythonFrameRing(const QSize &size, QImage::Format format, int count);
+    virtual ~QPythonFrameRing();
+
+    // Rings are looked up by the name of their PyFrameStream
+    static void registerRing(const QString &name, QSharedPointer<QPythonFrameRing> ring);
+    static void unregisterRing(const QString &name, QPythonFrameRing *ring);
+    static QSharedPointer<QPythonFrameRing> find(const QString &name);
+
+    QSize size() const { return m_size; }
+    QImage::Format format() const { return m_format; }
+    int bytesPerLine() const { return m_bytesPerLine; }
+    int byteCount() const { return m_bytesPerLine * m_size.height(); }
+    uchar *bits(int index) { return m_bits[index]; }
+
+    // Index of a buffer to fill, -1 if all buffers are in use
+    int acquire();
+    // Mark an acquired buffer as complete; older unpresented frames are dropped
+    bool commit(int index);
+    // Give back an acquired buffer without committing it
+    void release(int index);
+
+    // Newest committed frame (not copied), or a null image if there is none;
+    // it stays untouched until the next call
+    QImage takeNewest();
+
+    int presented();
+    int dropped();
+
+signals:
+    // Emitted once until takeNewest() is called
+    void frameCommitted();
+
+private:
+    enum State {
+        Free,
+        Writing,
+        Ready,
+        Presented,
+    };
+
+    QSize m_size;
+    QImage::Format m_format;
+    int m_bytesPerLine;
+
+    QMutex m_mutex;
+    QList<QByteArray> m_buffers;
+    QList<uchar *> m_bits;
+    QList<int> m_states;
+    int m_presented;
+    int m_dropped;
+    bool m_notified;
+};
+
+#endif /* PYOTHERSIDE_QPYTHON_FRAMESTREAM_H */
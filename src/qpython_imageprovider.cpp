@@ -16,18 +16,30 @@
  * PERFORMANCE OF THIS SOFTWARE.
  **/
 
+#include "qml_python_bridge.h"
+
 #include "qpython_priv.h"
 
 #include "qpython_imageprovider.h"
+#include "qpython_texturefactory.h"
 #include "ensure_gil_state.h"
 
 #include <QDebug>
 #include <QSvgRenderer>
 #include <QPainter>
+#include <QImageReader>
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QRunnable>
+#include <QThread>
+#include <QMutexLocker>
+
+#include <string.h>
 
 
-QPythonImageProvider::QPythonImageProvider()
-    : QQuickImageProvider(QQmlImageProviderBase::Image)
+QPythonImageProvider::QPythonImageProvider(const QString &name, QQmlImageProviderBase::ImageType type)
+    : QQuickImageProvider(type)
+    , name(name)
 {
 }
 
@@ -38,10 +50,11 @@ QPythonImageProvider::~QPythonImageProvider()
 static void
 cleanup_python_qimage(void *data)
 {
-    QPythonPriv *priv = QPythonPriv::instance();
+    Py_buffer *view = static_cast<Py_buffer *>(data);
 
     ENSURE_GIL_STATE;
-    Py_XDECREF(static_cast<PyObject *>(data));
+    PyBuffer_Release(view);
+    delete view;
 }
 
 QImage
@@ -49,29 +62,72 @@ QPythonImageProvider::requestImage(const QString &id, QSize *size, const QSize &
 {
     QImage img;
 
-    // Image data (and metadata) returned from Python
-    PyObject *pixels = NULL;
-    int width = 0, height = 0;
-    int format = 0;
-
-    // For counting the number of required bytes
-    int bitsPerPixel = 0;
-    size_t requiredBytes = 0;
-    size_t actualBytes = 0;
-
     QPythonPriv *priv = QPythonPriv::instance();
     if (!priv) {
         qWarning() << "Python component not instantiated yet";
         return QImage();
     }
 
-    if (!priv->image_provider) {
+    if (name.isEmpty() && !priv->image_provider) {
         qWarning() << "No image provider set in Python code";
         return QImage();
     }
 
+    if (priv->lookupImage(name, id, requestedSize, &img)) {
+        *size = img.size();
+        return img;
+    }
+
+    QPythonEncodedImage encoded;
+
+    {
+        ENSURE_GIL_STATE;
+
+        PyObjectRef result(callProvider(name, id, requestedSize), true);
+        if (!result) {
+            qDebug() << "Error while calling the image provider";
+            PyErr_Print();
+        } else {
+            img = convertResult(result.borrow(), &encoded);
+        }
+    }
+
+    if (encoded.view) {
+        img = encoded.decode(requestedSize);
+        encoded.release();
+    }
+
+    priv->storeImage(name, id, requestedSize, img);
+
+    *size = img.size();
+    return img;
+}
+
+QQuickTextureFactory *
+QPythonImageProvider::requestTexture(const QString &id, QSize *size, const QSize &requestedSize)
+{
+    QImage img = requestImage(id, size, requestedSize);
+    if (img.isNull()) {
+        return NULL;
+    }
+
+    // Uploads the pixel data from Python as-is, if the format allows it
+    return new QPythonTextureFactory(img);
+}
+
+PyObject *
+QPythonImageProvider::callProvider(const QString &name, const QString &id, const QSize &requestedSize)
+{
+    QPythonPriv *priv = QPythonPriv::instance();
     QByteArray id_utf8 = id.toUtf8();
 
+    PyObject *provider = priv->imageProvider(name);
+    if (!provider) {
+        PyErr_Format(PyExc_RuntimeError, "No image provider set in Python code for %s",
+                name.isEmpty() ? "image://python/" : qPrintable("image://" + name + "/"));
+        return NULL;
+    }
+
     // Image provider implementation in Python:
     //
     // import pyotherside
@@ -83,30 +139,51 @@ QPythonImageProvider::requestImage(const QString &id, QSize *size, const QSize &
     //     pixels = ...
     //     format = pyotherside.format_argb32 # or some other format
     //     return (bytearray(pixels), (width, height), format)
+    //     # or, with an explicit stride (bytes per scanline):
+    //     return (bytearray(pixels), (width, height), format, bytes_per_line)
     //
     // pyotherside.set_image_provider(image_provider)
-
-    ENSURE_GIL_STATE;
+    // # or, for image://thumbnails/ URLs:
+    // pyotherside.set_image_provider('thumbnails', image_provider, max_concurrency=2)
 
     PyObjectRef args(Py_BuildValue("(N(ii))",
             PyUnicode_FromString(id_utf8.constData()),
             requestedSize.width(), requestedSize.height()), true);
-    PyObjectRef result(PyObject_Call(priv->image_provider.borrow(), args.borrow(), NULL), true);
+    return PyObject_Call(provider, args.borrow(), NULL);
+}
 
-    if (!result) {
-        qDebug() << "Error while calling the image provider";
-        PyErr_Print();
-        goto cleanup;
-    }
+QImage
+QPythonImageProvider::convertResult(PyObject *result, QPythonEncodedImage *encoded)
+{
+    QImage img;
+
+    // Image data (and metadata) returned from Python
+    PyObject *pixels = NULL;
+    Py_buffer *view = NULL;
+    int width = 0, height = 0;
+    int format = 0;
+    int bytesPerLine = -1;
 
-    if (!PyArg_ParseTuple(result.borrow(), "O(ii)i", &pixels, &width, &height, &format)) {
+    // For counting the number of required bytes
+    int bitsPerPixel = 0;
+    qint64 minBytesPerLine = 0;
+    qint64 requiredBytes = 0;
+    qint64 actualBytes = 0;
+
+    if (!PyArg_ParseTuple(result, "O(ii)i|i", &pixels, &width, &height, &format, &bytesPerLine)) {
         PyErr_Clear();
-        qDebug() << "Image provider must return (pixels, (width, height), format)";
+        qDebug() << "Image provider must return (pixels, (width, height), format[, bytes_per_line])";
         goto cleanup;
     }
 
-    if (!PyByteArray_Check(pixels)) {
-        qDebug() << "Image data must be a Python bytearray()";
+    // Any object supporting the buffer protocol (bytearray, bytes, memoryview,
+    // array.array, mmap, numpy arrays, ...) can be used without copying
+    view = new Py_buffer;
+    if (PyObject_GetBuffer(pixels, view, PyBUF_C_CONTIGUOUS) != 0) {
+        PyErr_Clear();
+        delete view;
+        view = NULL;
+        qDebug() << "Image data must be a C-contiguous buffer (e.g. bytearray)";
         goto cleanup;
     }
 
@@ -119,49 +196,125 @@ QPythonImageProvider::requestImage(const QString &id, QSize *size, const QSize &
         case QImage::Format_MonoLSB:
             bitsPerPixel = 1;
             break;
-        case QImage::Format_RGB32:
-        case QImage::Format_ARGB32:
-            bitsPerPixel = 32;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 5, 0)
+        case QImage::Format_Alpha8:
+        case QImage::Format_Grayscale8:
+            bitsPerPixel = 8;
             break;
+#endif
         case QImage::Format_RGB16:
         case QImage::Format_RGB555:
         case QImage::Format_RGB444:
+        case QImage::Format_ARGB4444_Premultiplied:
+#if QT_VERSION >= QT_VERSION_CHECK(5, 13, 0)
+        case QImage::Format_Grayscale16:
+#endif
             bitsPerPixel = 16;
             break;
         case QImage::Format_RGB666:
         case QImage::Format_RGB888:
+        case QImage::Format_ARGB8565_Premultiplied:
+        case QImage::Format_ARGB6666_Premultiplied:
+        case QImage::Format_ARGB8555_Premultiplied:
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+        case QImage::Format_BGR888:
+#endif
             bitsPerPixel = 24;
             break;
+        case QImage::Format_RGB32:
+        case QImage::Format_ARGB32:
+        case QImage::Format_ARGB32_Premultiplied:
+#if QT_VERSION >= QT_VERSION_CHECK(5, 2, 0)
+        case QImage::Format_RGBX8888:
+        case QImage::Format_RGBA8888:
+        case QImage::Format_RGBA8888_Premultiplied:
+#endif
+#if QT_VERSION >= QT_VERSION_CHECK(5, 4, 0)
+        case QImage::Format_BGR30:
+        case QImage::Format_A2BGR30_Premultiplied:
+        case QImage::Format_RGB30:
+        case QImage::Format_A2RGB30_Premultiplied:
+#endif
+            bitsPerPixel = 32;
+            break;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+        case QImage::Format_RGBX64:
+        case QImage::Format_RGBA64:
+        case QImage::Format_RGBA64_Premultiplied:
+#if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
+        case QImage::Format_RGBX16FPx4:
+        case QImage::Format_RGBA16FPx4:
+        case QImage::Format_RGBA16FPx4_Premultiplied:
+#endif
+            bitsPerPixel = 64;
+            break;
+#endif
+#if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
+        case QImage::Format_RGBX32FPx4:
+        case QImage::Format_RGBA32FPx4:
+        case QImage::Format_RGBA32FPx4_Premultiplied:
+            bitsPerPixel = 128;
+            break;
+#endif
         default:
             qDebug() << "Invalid format:" << format;
             goto cleanup;
     }
 
-    requiredBytes = (bitsPerPixel * width * height + 7) / 8;
-    actualBytes = PyByteArray_Size(pixels);
-
-    // QImage requires scanlines to be 32-bit aligned. Scanlines from Python
-    // are considered to be tightly packed, we have to check for alignment.
-    // While we could re-pack the data to be aligned, we don't want to do that
-    // for performance reasons.
-    // If we're using 32-bit data (e.g. ARGB32), it will always be aligned.
-    if (format >= 0 && bitsPerPixel != 32) {
-        if ((bitsPerPixel * width) % 32 != 0) {
-            // If actualBytes > requiredBytes, we can check if there are enough
-            // bytes to consider the data 32-bit aligned (from Python) and avoid
-            // the error (scanlines must be padded to multiples of 4 bytes)
-            if ((unsigned int)(((width * bitsPerPixel / 8 + 3) / 4) * 4 * height) == actualBytes) {
-                qDebug() << "Assuming 32-bit aligned scanlines from Python";
-            } else {
-                qDebug() << "Each scanline of data must be 32-bit aligned";
-                goto cleanup;
-            }
+    if (format >= 0 && (width <= 0 || height <= 0)) {
+        qDebug() << "Invalid image size:" << QSize(width, height);
+        goto cleanup;
+    }
+
+    minBytesPerLine = ((qint64)bitsPerPixel * width + 7) / 8;
+    actualBytes = view->len;
+
+    if (format >= 0 && minBytesPerLine + 3 > INT_MAX) {
+        qDebug() << "Image too wide:" << width << "pixels";
+        goto cleanup;
+    }
+
+    if (format >= 0 && bytesPerLine >= 0) {
+        // Explicit stride from Python (e.g. padded rows from a camera or
+        // decoder library), the data can be wrapped as-is in any case
+        if (bytesPerLine < minBytesPerLine) {
+            qDebug() << "bytes_per_line" << bytesPerLine << "too small for" <<
+                width << "pixels of format" << (enum QImage::Format)format <<
+                "(need at least" << minBytesPerLine << "bytes)";
+            goto cleanup;
+        }
+
+        // Rows must start at pixel boundaries for formats with multi-byte
+        // pixels that Qt accesses as 16/32/64-bit words
+        if (bitsPerPixel >= 16 && bitsPerPixel != 24 &&
+                bytesPerLine % qMin(bitsPerPixel / 8, 8) != 0) {
+            qDebug() << "bytes_per_line" << bytesPerLine <<
+                "must be a multiple of" << qMin(bitsPerPixel / 8, 8) <<
+                "for format" << (enum QImage::Format)format;
+            goto cleanup;
+        }
+    } else if (format >= 0) {
+        // Without an explicit stride, scanlines from Python are considered
+        // to be tightly packed. For compatibility with earlier versions, if
+        // the data has exactly the size of 32-bit aligned scanlines, assume
+        // it is padded (like QImage's own scanlines).
+        qint64 alignedBytesPerLine = (minBytesPerLine + 3) / 4 * 4;
+        if (alignedBytesPerLine != minBytesPerLine &&
+                alignedBytesPerLine * height == actualBytes) {
+            qDebug() << "Assuming 32-bit aligned scanlines from Python";
+            bytesPerLine = (int)alignedBytesPerLine;
+        } else {
+            bytesPerLine = (int)minBytesPerLine;
         }
     }
 
+    // The last scanline doesn't need to have any padding after the pixels
+    requiredBytes = (qint64)bytesPerLine * (height - 1) + minBytesPerLine;
+
     if (format >= 0 && requiredBytes > actualBytes) {
         qDebug() << "Format" << (enum QImage::Format)format <<
             "at size" << QSize(width, height) <<
+            "with" << bytesPerLine << "bytes per line" <<
             "requires at least" << requiredBytes <<
             "bytes of image data, got only" << actualBytes << "bytes";
         goto cleanup;
@@ -169,81 +322,609 @@ QPythonImageProvider::requestImage(const QString &id, QSize *size, const QSize &
 
     if (format < 0) {
         switch (format) {
-        case PYOTHERSIDE_IMAGE_FORMAT_ENCODED: {
-            // Pixel data is actually encoded image data that we need to decode
-            img.loadFromData((const unsigned char*)PyByteArray_AsString(pixels), PyByteArray_Size(pixels));
+        case PYOTHERSIDE_IMAGE_FORMAT_ENCODED:
+        case PYOTHERSIDE_IMAGE_FORMAT_SVG:
+            // Decoding can take a while, this is done by the caller once the
+            // GIL has been released (the buffer keeps the data alive)
+            encoded->view = view;
+            encoded->format = format;
+            encoded->size = QSize(width, height);
+            view = NULL;
+            break;
+        default:
+            qWarning() << "Unknown format" << format <<
+                "has been specified and will not be handled.";
             break;
         }
-        case PYOTHERSIDE_IMAGE_FORMAT_SVG: {
-            // Convert the Python byte array to a QByteArray
-            QByteArray svgDataArray(PyByteArray_AsString(pixels), PyByteArray_Size(pixels));
-
-            // Load the SVG data to the SVG renderer
-            QSvgRenderer renderer(svgDataArray);
-
-            // Handle width, height or both not being set
-            QSize defaultSize = renderer.defaultSize();
-            int defaultWidth = defaultSize.width();
-            int defaultHeight = defaultSize.height();
-
-            if (width < 0 && height < 0) {
-                // Both Width and Height have not been set - use the defaults from the SVG data
-                // (each SVG image has a default size)
-                // NOTE: we get a -1,-1 requestedSize only if sourceSize is not set at all,
-                //       if either width or height is set then the other one is 0, not -1
-                width = defaultWidth;
-                height = defaultHeight;
-            } else { // At least width or height is valid
-                if (width <= 0) {
-                    // Width is not set, use default width scaled according to height to keep
-                    // aspect ratio
-                    if (defaultHeight != 0) {  // Protect from division by zero
-                        width = (float)defaultWidth*((float)height/(float)defaultHeight);
-                    }
+    } else if (bitsPerPixel >= 16 && bitsPerPixel != 24 &&
+            (quintptr)view->buf % qMin(bitsPerPixel / 8, 8) != 0) {
+        // Like misaligned rows, but the buffer itself (e.g. a memoryview
+        // sliced at an odd offset) can't be fixed from Python as easily,
+        // so the pixels are copied to memory that Qt allocates instead
+        qDebug() << "Copying image data at misaligned address" << view->buf;
+        img = QImage(width, height, (enum QImage::Format)format);
+        if (!img.isNull()) {
+            for (int y=0; y<height; y++) {
+                memcpy(img.scanLine(y), (const char *)view->buf + (qint64)bytesPerLine * y,
+                        minBytesPerLine);
+            }
+        }
+    } else {
+        // Need to keep the buffer (and with it the object exporting it), as it
+        // contains the backing store data for the QImage.
+        // Will be released by cleanup_python_qimage once the QImage is gone.
+        img = QImage((const unsigned char *)view->buf,
+                width, height, bytesPerLine, (enum QImage::Format)format,
+                cleanup_python_qimage, view);
+        view = NULL;
+    }
+
+cleanup:
+
+    if (view) {
+        PyBuffer_Release(view);
+        delete view;
+    }
+
+    return img;
+}
+
+// Parsed SVG document, reused for rendering the same SVG data at other sizes
+class QPythonSvgDocument : public QPythonSvgCacheEntry {
+public:
+    QPythonSvgDocument(const QByteArray &data)
+        : mutex()
+        , renderer(data)
+    {
+        // Only still images are rendered, don't run an animation timer
+        renderer.setFramesPerSecond(0);
+    }
+
+    // QSvgRenderer is not reentrant, rendering is serialized per document
+    QMutex mutex;
+    QSvgRenderer renderer;
+};
+
+static QSharedPointer<QPythonSvgCacheEntry>
+get_svg_document(const QByteArray &data)
+{
+    QPythonPriv *priv = QPythonPriv::instance();
+    QByteArray key = QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+
+    QSharedPointer<QPythonSvgCacheEntry> document = priv->lookupSvg(key);
+    if (!document) {
+        document = QSharedPointer<QPythonSvgCacheEntry>(new QPythonSvgDocument(data));
+        if (static_cast<QPythonSvgDocument *>(document.data())->renderer.isValid()) {
+            priv->storeSvg(key, document, data.size());
+        }
+    }
+
+    return document;
+}
+
+static QSize
+scaled_size(const QSize &size, const QSize &requestedSize)
+{
+    // Like the sourceSize of QML images: scale down to fit into the requested
+    // size keeping the aspect ratio, an unset (<= 0) dimension is unbounded
+    if (size.isEmpty() || (requestedSize.width() <= 0 && requestedSize.height() <= 0)) {
+        return QSize();
+    }
+
+    qreal factor = 1.0;
+    if (requestedSize.width() > 0) {
+        factor = qMin(factor, (qreal)requestedSize.width() / size.width());
+    }
+    if (requestedSize.height() > 0) {
+        factor = qMin(factor, (qreal)requestedSize.height() / size.height());
+    }
+
+    if (factor >= 1.0) {
+        // Never scale up
+        return QSize();
+    }
+
+    return QSize(qMax(1, qRound(size.width() * factor)),
+                 qMax(1, qRound(size.height() * factor)));
+}
+
+QImage
+QPythonEncodedImage::decode(const QSize &requestedSize) const
+{
+    QImage img;
+
+    // The buffer is exported, so the data stays alive and can't be resized
+    // while we read it without holding the GIL
+    QByteArray data = QByteArray::fromRawData((const char *)view->buf, view->len);
+
+    switch (format) {
+    case PYOTHERSIDE_IMAGE_FORMAT_ENCODED: {
+        // Pixel data is actually encoded image data that we need to decode;
+        // large images are decoded at the requested size directly (formats
+        // such as JPEG support this natively, saving time and memory)
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::ReadOnly);
+        QImageReader reader(&buffer);
+
+        QSize scaled = scaled_size(reader.size(), requestedSize);
+        if (scaled.isValid()) {
+            reader.setScaledSize(scaled);
+        }
+
+        if (!reader.read(&img)) {
+            qDebug() << "Cannot decode image data:" << reader.errorString();
+        }
+        break;
+    }
+    case PYOTHERSIDE_IMAGE_FORMAT_SVG: {
+        // Parse the SVG data (unless it has been parsed before)
+        QSharedPointer<QPythonSvgCacheEntry> entry = get_svg_document(data);
+        QPythonSvgDocument *document = static_cast<QPythonSvgDocument *>(entry.data());
+        QMutexLocker lock(&document->mutex);
+        QSvgRenderer &renderer = document->renderer;
+
+        int width = size.width();
+        int height = size.height();
+
+        // Handle width, height or both not being set
+        QSize defaultSize = renderer.defaultSize();
+        int defaultWidth = defaultSize.width();
+        int defaultHeight = defaultSize.height();
+
+        if (width < 0 && height < 0) {
+            // Both Width and Height have not been set - use the defaults from the SVG data
+            // (each SVG image has a default size)
+            // NOTE: we get a -1,-1 requestedSize only if sourceSize is not set at all,
+            //       if either width or height is set then the other one is 0, not -1
+            width = defaultWidth;
+            height = defaultHeight;
+        } else { // At least width or height is valid
+            if (width <= 0) {
+                // Width is not set, use default width scaled according to height to keep
+                // aspect ratio
+                if (defaultHeight != 0) {  // Protect from division by zero
+                    width = (float)defaultWidth*((float)height/(float)defaultHeight);
                 }
+            }
 
-                if (height <= 0) {
-                    // Height is not set, use default height scaled according to width to keep
-                    // aspect ratio
-                    if (defaultWidth != 0) {  // Protect from division by zero
-                        height = (float)defaultHeight*((float)width/(float)defaultWidth);
-                    }
+            if (height <= 0) {
+                // Height is not set, use default height scaled according to width to keep
+                // aspect ratio
+                if (defaultWidth != 0) {  // Protect from division by zero
+                    height = (float)defaultHeight*((float)width/(float)defaultWidth);
                 }
             }
+        }
 
-            // The pixel data is actually SVG image data that we need to render at correct size
-            //
-            // Note: according to the QImage and QPainter documentation the optimal QImage
-            // format for drawing is Format_ARGB32_Premultiplied
-            img = QImage(width, height, QImage::Format_ARGB32_Premultiplied);
+        // The pixel data is actually SVG image data that we need to render at correct size
+        //
+        // Note: according to the QImage and QPainter documentation the optimal QImage
+        // format for drawing is Format_ARGB32_Premultiplied
+        img = QImage(width, height, QImage::Format_ARGB32_Premultiplied);
 
-            // According to the documentation an empty QImage needs to be "flushed" before
-            // being used with QPainter to prevent rendering artifacts from showing up
-            img.fill(Qt::transparent);
+        // According to the documentation an empty QImage needs to be "flushed" before
+        // being used with QPainter to prevent rendering artifacts from showing up
+        img.fill(Qt::transparent);
 
-            // Paints the rendered SVG to the QImage instance
-            QPainter painter(&img);
-            renderer.render(&painter);
-            break;
+        // Paints the rendered SVG to the QImage instance
+        QPainter painter(&img);
+        renderer.render(&painter);
+        break;
+    }
+    default:
+        break;
+    }
+
+    return img;
+}
+
+void
+QPythonEncodedImage::release()
+{
+    if (view) {
+        ENSURE_GIL_STATE;
+        PyBuffer_Release(view);
+        delete view;
+        view = NULL;
+    }
+}
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 6, 0)
+
+QPythonImageResponse::QPythonImageResponse(const QString &provider, const QString &id, const QSize &requestedSize)
+    : QQuickImageResponse()
+    , provider(provider)
+    , id(id)
+    , requested_size(requestedSize)
+    , cancelled(0)
+    , token(0)
+    , image()
+    , error()
+{
+}
+
+QPythonImageResponse::~QPythonImageResponse()
+{
+}
+
+QQuickTextureFactory *
+QPythonImageResponse::textureFactory() const
+{
+    if (image.isNull()) {
+        return NULL;
+    }
+
+    // Icons and thumbnails should still end up in the scene graph's atlas,
+    // direct uploads are only used for image://python-texture/
+    return QQuickTextureFactory::textureFactoryForImage(image);
+}
+
+QString
+QPythonImageResponse::errorString() const
+{
+    return error;
+}
+
+void
+QPythonImageResponse::cancel()
+{
+    // finished() is still emitted once the request notices (which is right
+    // away if it did not start yet), the engine deletes the response then
+    cancelled.storeRelease(1);
+
+    int t = token.loadAcquire();
+    if (t != 0) {
+        QMetaObject::invokeMethod(QPythonImageLoop::instance(), "cancel",
+                Qt::QueuedConnection, Q_ARG(int, t));
+    }
+}
+
+void
+QPythonImageResponse::finish(const QImage &image, const QString &error)
+{
+    this->image = image;
+    this->error = error;
+    if (this->error.isNull() && image.isNull() && !cancelled.loadAcquire()) {
+        this->error = "Image provider did not return a valid image";
+    }
+
+    emit finished();
+}
+
+
+class QPythonImageTask : public QRunnable {
+public:
+    QPythonImageTask(QPythonImageResponse *response) : QRunnable(), response(response) {}
+
+    virtual void run();
+
+private:
+    QPythonImageResponse *response;
+};
+
+void
+QPythonImageTask::run()
+{
+    if (response->cancelled.loadAcquire()) {
+        response->finish(QImage(), "Cancelled");
+        return;
+    }
+
+    QPythonPriv *priv = QPythonPriv::instance();
+    if (!priv) {
+        response->finish(QImage(), "Python component not instantiated yet");
+        return;
+    }
+
+    QImage image;
+    QString error;
+    QPythonEncodedImage encoded;
+
+    if (priv->lookupImage(response->provider, response->id, response->requested_size, &image)) {
+        response->finish(image);
+        return;
+    }
+
+    {
+        ENSURE_GIL_STATE;
+
+        if (!priv->imageProvider(response->provider)) {
+            error = "No image provider set in Python code";
+        } else {
+            PyObjectRef result(QPythonImageProvider::callProvider(response->provider,
+                        response->id, response->requested_size), true);
+            if (!result) {
+                error = QString("Error while calling the image provider: %1")
+                    .arg(priv->formatExc());
+            } else if (QPythonPriv::isAwaitable(result.borrow())) {
+                if (QPythonImageLoop::instance()->schedule(response, result.borrow())) {
+                    // Finished by the event loop thread
+                    return;
+                }
+                error = QString("Cannot schedule awaitable: %1").arg(priv->formatExc());
+            } else {
+                image = QPythonImageProvider::convertResult(result.borrow(), &encoded);
+            }
         }
-        default:
-            qWarning() << "Unknown format" << format <<
-                "has been specified and will not be handled.";
-            break;
+    }
+
+    if (encoded.view) {
+        image = encoded.decode(response->requested_size);
+        encoded.release();
+    }
+
+    // Not holding the GIL, as the engine might react to finished() directly
+    priv->storeImage(response->provider, response->id, response->requested_size, image);
+    response->finish(image, error);
+}
+
+
+QPythonImageLoop *
+QPythonImageLoop::instance()
+{
+    static QMutex mutex;
+    static QPythonImageLoop *loop = NULL;
+
+    QMutexLocker lock(&mutex);
+    if (loop == NULL) {
+        QThread *thread = new QThread;
+        thread->setObjectName("QPythonImageLoop");
+        loop = new QPythonImageLoop;
+        loop->moveToThread(thread);
+        thread->start();
+    }
+
+    return loop;
+}
+
+QPythonImageLoop::QPythonImageLoop()
+    : QObject()
+    , runner()
+    , watcher(new QPythonAsyncioWatcher(this))
+    , responses()
+    , starting_mutex()
+    , starting()
+    , next_token(1)
+{
+    QObject::connect(watcher, SIGNAL(activated()), this, SLOT(step()));
+}
+
+bool
+QPythonImageLoop::schedule(QPythonImageResponse *response, PyObject *awaitable)
+{
+    // The asyncio event loop must only be used from its own thread
+    int t;
+    {
+        QMutexLocker lock(&starting_mutex);
+        t = next_token++;
+        Starting s = { response, PyObjectRef(awaitable) };
+        starting.insert(t, s);
+    }
+
+    return QMetaObject::invokeMethod(this, "start", Qt::QueuedConnection, Q_ARG(int, t));
+}
+
+void
+QPythonImageLoop::start(int token)
+{
+    ENSURE_GIL_STATE;
+
+    Starting s;
+    {
+        QMutexLocker lock(&starting_mutex);
+        s = starting.take(token);
+    }
+
+    QPythonPriv *priv = QPythonPriv::instance();
+
+    QString error;
+    if (!runner) {
+        runner = PyObjectRef(priv->createAsyncioRunner(&error), true);
+    }
+
+    if (runner) {
+        PyObjectRef scheduled(PyObject_CallMethod(runner.borrow(), "schedule", "iO",
+                    token, s.awaitable.borrow()), true);
+        if (scheduled) {
+            responses.insert(token, s.response);
+            s.response->token.storeRelease(token);
+            if (s.response->cancelled.loadAcquire()) {
+                cancel(token);
+            }
+            watcher->wakeUp();
+            return;
         }
-    } else {
-        // Need to keep a reference to the byte array object, as it contains
-        // the backing store data for the QImage.
-        // Will be decref'd by cleanup_python_qimage once the QImage is gone.
-        Py_INCREF(pixels);
+        error = QString("Cannot schedule awaitable: %1").arg(priv->formatExc());
+    }
+
+    s.awaitable = PyObjectRef();
+    s.response->finish(QImage(), error);
+}
 
-        img = QImage((const unsigned char *)PyByteArray_AsString(pixels),
-                width, height, (enum QImage::Format)format,
-                cleanup_python_qimage, pixels);
+void
+QPythonImageLoop::cancel(int token)
+{
+    if (!responses.contains(token)) {
+        // Already finished
+        return;
     }
 
-cleanup:
+    ENSURE_GIL_STATE;
 
-    *size = img.size();
-    return img;
+    PyObjectRef result(PyObject_CallMethod(runner.borrow(), "cancel", "i", token), true);
+    if (!result) {
+        PyErr_Print();
+    }
+    watcher->wakeUp();
+}
+
+void
+QPythonImageLoop::step()
+{
+    QList<QPythonImageResponse *> done;
+    QList<QImage> images;
+    QList<QPythonEncodedImage> encoded;
+    QStringList errors;
+
+    {
+        ENSURE_GIL_STATE;
+
+        QPythonPriv *priv = QPythonPriv::instance();
+
+        PyObjectRef result(PyObject_CallMethod(runner.borrow(), "step", NULL), true);
+
+        PyObject *finished = result ? watcher->update(result.borrow()) : NULL;
+        if (!finished) {
+            qWarning() << "Cannot run asyncio event loop:" << priv->formatExc();
+            // Try again later, so that pending requests are not stuck forever
+            watcher->wakeUp(100);
+            return;
+        }
+
+        PyObjectRef iter(PyObject_GetIter(finished), true);
+        PyObjectRef item;
+        while (iter && (item = PyObjectRef(PyIter_Next(iter.borrow()), true))) {
+            int token = 0;
+            int ok = 0;
+            PyObject *value = NULL;
+            if (!PyArg_ParseTuple(item.borrow(), "ipO", &token, &ok, &value)) {
+                PyErr_Print();
+                continue;
+            }
+
+            QPythonImageResponse *response = responses.take(token);
+            if (!response) {
+                continue;
+            }
+
+            done << response;
+            encoded << QPythonEncodedImage();
+            if (ok) {
+                images << QPythonImageProvider::convertResult(value, &encoded.last());
+                errors << QString();
+            } else {
+                images << QImage();
+                errors << convertPyObjectToQVariant(value).toString();
+            }
+        }
+    }
+
+    QPythonPriv *priv = QPythonPriv::instance();
+    for (int i=0; i<done.count(); i++) {
+        if (encoded[i].view) {
+            images[i] = encoded[i].decode(done[i]->requested_size);
+            encoded[i].release();
+        }
+        priv->storeImage(done[i]->provider, done[i]->id, done[i]->requested_size, images[i]);
+        done[i]->finish(images[i], errors[i]);
+    }
+}
+
+
+QPythonAsyncImageProvider::QPythonAsyncImageProvider(const QString &name, QSharedPointer<QThreadPool> pool)
+    : QQuickAsyncImageProvider()
+    , name(name)
+    , pool(pool)
+{
+    if (!this->pool) {
+        this->pool = QSharedPointer<QThreadPool>(new QThreadPool);
+
+        bool ok = false;
+        int count = qgetenv("PYOTHERSIDE_IMAGE_THREADS").toInt(&ok);
+        if (ok && count > 0) {
+            this->pool->setMaxThreadCount(count);
+        }
+    }
+}
+
+QPythonAsyncImageProvider::~QPythonAsyncImageProvider()
+{
+    pool->waitForDone();
+}
+
+QQuickImageResponse *
+QPythonAsyncImageProvider::requestImageResponse(const QString &id, const QSize &requestedSize)
+{
+    QPythonImageResponse *response = new QPythonImageResponse(name, id, requestedSize);
+    pool->start(new QPythonImageTask(response));
+    return response;
+}
+
+#endif /* QT_VERSION >= 5.6.0 */
+
+
+QPythonImageProviderRegistry::QPythonImageProviderRegistry()
+    : QObject()
+    , engines()
+    , providers()
+#if QT_VERSION >= QT_VERSION_CHECK(5, 6, 0)
+    , pools()
+#endif
+{
+}
+
+QPythonImageProviderRegistry *
+QPythonImageProviderRegistry::instance()
+{
+    // Only used from the GUI thread
+    static QPythonImageProviderRegistry *registry = NULL;
+
+    if (registry == NULL) {
+        registry = new QPythonImageProviderRegistry;
+        QObject::connect(QPythonPriv::start(true), SIGNAL(imageProviderChanged(QString,int)),
+                registry, SLOT(setProvider(QString,int)));
+    }
+
+    return registry;
+}
+
+void
+QPythonImageProviderRegistry::addEngine(QQmlEngine *engine)
+{
+    engines.append(QPointer<QQmlEngine>(engine));
+
+    QMap<QString,int>::const_iterator it;
+    for (it=providers.constBegin(); it != providers.constEnd(); ++it) {
+        addProvider(engine, it.key());
+    }
+}
+
+void
+QPythonImageProviderRegistry::setProvider(QString name, int maxConcurrency)
+{
+    bool added = !providers.contains(name);
+    providers[name] = maxConcurrency;
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 6, 0)
+    // Each named provider gets its own threads, so that a slow provider
+    // can't block requests for other providers
+    if (!pools.contains(name)) {
+        pools[name] = QSharedPointer<QThreadPool>(new QThreadPool);
+    }
+    pools[name]->setMaxThreadCount(maxConcurrency);
+#endif
+
+    if (added) {
+        for (int i=0; i<engines.count(); i++) {
+            if (engines[i]) {
+                addProvider(engines[i], name);
+            }
+        }
+    }
+}
+
+void
+QPythonImageProviderRegistry::addProvider(QQmlEngine *engine, const QString &name)
+{
+    if (engine->imageProvider(name)) {
+        // Already registered (e.g. by the application)
+        return;
+    }
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 6, 0)
+    engine->addImageProvider(name, new QPythonAsyncImageProvider(name, pools[name]));
+#else
+    // Synchronous providers share the engine's image loading thread
+    engine->addImageProvider(name, new QPythonImageProvider(name));
+#endif
 }
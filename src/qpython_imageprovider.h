@@ -19,14 +19,159 @@
 #ifndef PYOTHERSIDE_QPYTHON_IMAGEPROVIDER_H
 #define PYOTHERSIDE_QPYTHON_IMAGEPROVIDER_H
 
+#include "python_wrap.h"
+
+#include "pyobject_ref.h"
+#include "qpython_asynciowatcher.h"
+
 #include <QQuickImageProvider>
+#include <QThreadPool>
+#include <QAtomicInt>
+#include <QTimer>
+#include <QMap>
+#include <QMutex>
+#include <QList>
+#include <QPointer>
+#include <QSharedPointer>
+#include <QQmlEngine>
+
+// Encoded image data (format_data, format_svg_data) returned from Python.
+// The buffer is held without copying, so that the data can be decoded or
+// rasterized after the GIL has been released.
+struct QPythonEncodedImage {
+    QPythonEncodedImage() : view(NULL), format(0), size() {}
+
+    // Decode at requestedSize (does not require the GIL)
+    QImage decode(const QSize &requestedSize) const;
+    // Release the buffer (takes the GIL)
+    void release();
+
+    Py_buffer *view;
+    int format;
+    QSize size;
+};
 
 class QPythonImageProvider : public QQuickImageProvider {
 public:
-    QPythonImageProvider();
+    // Empty name for the default provider (image://python/); with type
+    // Texture, requestTexture() is used (image://python-texture/)
+    QPythonImageProvider(const QString &name=QString(),
+            QQmlImageProviderBase::ImageType type=QQmlImageProviderBase::Image);
     virtual ~QPythonImageProvider();
 
     virtual QImage requestImage(const QString &id, QSize *size, const QSize &requestedSize);
+    virtual QQuickTextureFactory *requestTexture(const QString &id, QSize *size, const QSize &requestedSize);
+
+    // Call the named Python image provider (requires the GIL, new reference)
+    static PyObject *callProvider(const QString &name, const QString &id, const QSize &requestedSize);
+    // Convert the return value of the image provider (requires the GIL);
+    // encoded data is not decoded, but stored in *encoded instead
+    static QImage convertResult(PyObject *result, QPythonEncodedImage *encoded);
+
+private:
+    QString name;
+};
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 6, 0)
+
+class QPythonImageResponse : public QQuickImageResponse {
+    Q_OBJECT
+
+public:
+    QPythonImageResponse(const QString &provider, const QString &id, const QSize &requestedSize);
+    virtual ~QPythonImageResponse();
+
+    virtual QQuickTextureFactory *textureFactory() const;
+    virtual QString errorString() const;
+    virtual void cancel();
+
+    // Set the result and emit finished() (must be called exactly once)
+    void finish(const QImage &image, const QString &error=QString());
+
+    QString provider;
+    QString id;
+    QSize requested_size;
+    QAtomicInt cancelled;
+    QAtomicInt token;
+
+private:
+    QImage image;
+    QString error;
+};
+
+// Runs awaitables returned from Python image providers on an asyncio event
+// loop in a separate thread, see asyncio_runner.py
+class QPythonImageLoop : public QObject {
+    Q_OBJECT
+
+public:
+    static QPythonImageLoop *instance();
+
+    // Requires the GIL; false if the awaitable could not be scheduled
+    bool schedule(QPythonImageResponse *response, PyObject *awaitable);
+
+private slots:
+    void start(int token);
+    void step();
+    void cancel(int token);
+
+private:
+    QPythonImageLoop();
+
+    struct Starting {
+        QPythonImageResponse *response;
+        PyObjectRef awaitable;
+    };
+
+    PyObjectRef runner;
+    QPythonAsyncioWatcher *watcher;
+    QMap<int,QPythonImageResponse *> responses;
+
+    QMutex starting_mutex;
+    QMap<int,Starting> starting;
+    int next_token;
+};
+
+class QPythonAsyncImageProvider : public QQuickAsyncImageProvider {
+public:
+    // Without a pool, a new one is created (see PYOTHERSIDE_IMAGE_THREADS)
+    QPythonAsyncImageProvider(const QString &name=QString(),
+            QSharedPointer<QThreadPool> pool=QSharedPointer<QThreadPool>());
+    virtual ~QPythonAsyncImageProvider();
+
+    virtual QQuickImageResponse *requestImageResponse(const QString &id, const QSize &requestedSize);
+
+private:
+    QString name;
+    QSharedPointer<QThreadPool> pool;
+};
+
+#endif /* QT_VERSION >= 5.6.0 */
+
+// Registers the image providers set with pyotherside.set_image_provider(name,
+// provider) as image://<name>/ on all engines that loaded the plugin
+class QPythonImageProviderRegistry : public QObject {
+    Q_OBJECT
+
+public:
+    // Must be called from the GUI thread
+    static QPythonImageProviderRegistry *instance();
+
+    void addEngine(QQmlEngine *engine);
+
+private slots:
+    void setProvider(QString name, int maxConcurrency);
+
+private:
+    QPythonImageProviderRegistry();
+
+    void addProvider(QQmlEngine *engine, const QString &name);
+
+    QList<QPointer<QQmlEngine> > engines;
+    QMap<QString,int> providers;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 6, 0)
+    QMap<QString,QSharedPointer<QThreadPool> > pools;
+#endif
 };
 
 #endif /* PYOTHERSIDE_QPYTHON_IMAGEPROVIDER_H */
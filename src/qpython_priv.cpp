@@ -19,22 +19,47 @@
 #include "qml_python_bridge.h"
 
 #include "qpython_priv.h"
+#include "qpython_framestream.h"
 
 #include "ensure_gil_state.h"
 
+#include "marshal.h"
+
 #include <QImage>
 #include <QDebug>
 #include <QResource>
 #include <QFile>
+#include <QFileInfo>
 #include <QDir>
+#include <QDirIterator>
+#include <QHash>
+#include <QStringList>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+
+#include <QVarLengthArray>
 
 #include <QMetaObject>
 #include <QMetaProperty>
 #include <QMetaMethod>
 #include <QGenericArgument>
+#include <QThread>
+#include <QMutexLocker>
 
 static QPythonPriv *priv = NULL;
 
+// Added with QPythonPriv::addModuleSearchPath() before initialization
+static QStringList module_search_paths;
+
+// Zip archives in Qt Resources (":/..." entries in module_search_paths)
+// are imported by qrc_zipimporter.py instead of being put into sys.path
+static bool
+is_resource_archive(const QString &path)
+{
+    return path.startsWith(":");
+}
+
 static QString
 qstring_from_pyobject_arg(PyObject *object)
 {
@@ -73,6 +98,74 @@ PyTypeObject pyotherside_QObjectType = {
     "Wrapped QObject", /* tp_doc */
 };
 
+// Unbuffered reader for a file in Qt Resources, see QPythonPriv::openResource()
+typedef struct {
+    PyObject_HEAD
+    QFile *file;
+} pyotherside_QResourceFile;
+
+static PyTypeObject pyotherside_QResourceFileType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "pyotherside.QResourceFile", /* tp_name */
+    sizeof(pyotherside_QResourceFile), /* tp_basicsize */
+    0, /* tp_itemsize */
+    0, /* tp_dealloc */
+    0, /* tp_print */
+    0, /* tp_getattr */
+    0, /* tp_setattr */
+    0, /* tp_reserved */
+    0, /* tp_repr */
+    0, /* tp_as_number */
+    0, /* tp_as_sequence */
+    0, /* tp_as_mapping */
+    0, /* tp_hash  */
+    0, /* tp_call */
+    0, /* tp_str */
+    0, /* tp_getattro */
+    0, /* tp_setattro */
+    0, /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT, /* tp_flags */
+    "Raw reader for a file in Qt Resources", /* tp_doc */
+};
+
+// Writable frame buffer of a PyFrameStream, see pyotherside_acquire_frame()
+typedef struct {
+    PyObject_HEAD
+    // NULL once the frame has been committed
+    QSharedPointer<QPythonFrameRing> *ring;
+    int index;
+    // Live buffer exports (memoryview, NumPy arrays, ...)
+    int exports;
+    int width;
+    int height;
+    int bytes_per_line;
+    int format;
+} pyotherside_FrameBuffer;
+
+static PyTypeObject pyotherside_FrameBufferType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "pyotherside.FrameBuffer", /* tp_name */
+    sizeof(pyotherside_FrameBuffer), /* tp_basicsize */
+    0, /* tp_itemsize */
+    0, /* tp_dealloc */
+    0, /* tp_print */
+    0, /* tp_getattr */
+    0, /* tp_setattr */
+    0, /* tp_reserved */
+    0, /* tp_repr */
+    0, /* tp_as_number */
+    0, /* tp_as_sequence */
+    0, /* tp_as_mapping */
+    0, /* tp_hash  */
+    0, /* tp_call */
+    0, /* tp_str */
+    0, /* tp_getattro */
+    0, /* tp_setattro */
+    0, /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT, /* tp_flags */
+    "Frame buffer of a PyFrameStream", /* tp_doc */
+};
+
 PyTypeObject pyotherside_QObjectMethodType = {
     PyVarObject_HEAD_INIT(NULL, 0)
     "pyotherside.QObjectMethod", /* tp_name */
@@ -115,13 +208,214 @@ pyotherside_atexit(PyObject *self, PyObject *o)
 }
 
 PyObject *
-pyotherside_set_image_provider(PyObject *self, PyObject *o)
+pyotherside_set_image_provider(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    static const char *kwlist[] = {"name", "provider", "max_concurrency", NULL};
+    PyObject *name = NULL;
+    PyObject *provider = NULL;
+    int max_concurrency = 1;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|Oi:set_image_provider",
+                (char **)kwlist, &name, &provider, &max_concurrency)) {
+        return NULL;
+    }
+
+    if (provider == NULL) {
+        // set_image_provider(provider): image://python/ and image://python-async/
+        priv->image_provider = PyObjectRef(name);
+        Py_RETURN_NONE;
+    }
+
+    QString qname = qstring_from_pyobject_arg(name);
+    if (qname.isNull()) {
+        return NULL;
+    }
+
+    // The QML engine lowercases the host part of image:// URLs
+    bool valid = !qname.isEmpty();
+    for (int i=0; i<qname.length(); i++) {
+        QChar c = qname[i];
+        if (!((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-' || c == '_')) {
+            valid = false;
+        }
+    }
+
+    if (!valid) {
+        PyErr_Format(PyExc_ValueError, "Invalid image provider name: %S "
+                "(must consist of lowercase letters, digits, '-' and '_')", name);
+        return NULL;
+    }
+
+    if (qname == "python" || qname == "python-async" || qname == "python-texture") {
+        PyErr_Format(PyExc_ValueError, "Reserved image provider name: %S", name);
+        return NULL;
+    }
+
+    if (max_concurrency < 1) {
+        PyErr_SetString(PyExc_ValueError, "max_concurrency must be at least 1");
+        return NULL;
+    }
+
+    if (provider == Py_None) {
+        // image://<name>/ stays registered, but requests will fail
+        priv->image_providers.remove(qname);
+    } else {
+        priv->image_providers[qname] = PyObjectRef(provider);
+        emit priv->imageProviderChanged(qname, max_concurrency);
+    }
+
+    Py_RETURN_NONE;
+}
+
+// Name of an image provider given from Python; None and the URL schemes of
+// the default provider map to the default provider's empty (not null) name
+static bool
+image_provider_name(PyObject *name, QString *provider)
+{
+    if (name == Py_None) {
+        *provider = QString("");
+        return true;
+    }
+
+    *provider = qstring_from_pyobject_arg(name);
+    if (provider->isNull()) {
+        return false;
+    }
+
+    if (*provider == "python" || *provider == "python-async" || *provider == "python-texture") {
+        *provider = QString("");
+    }
+
+    return true;
+}
+
+PyObject *
+pyotherside_invalidate_image(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    static const char *kwlist[] = {"image_id", "name", NULL};
+    PyObject *image_id = Py_None;
+    PyObject *name = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|OO:invalidate_image",
+                (char **)kwlist, &image_id, &name)) {
+        return NULL;
+    }
+
+    QString id;
+    if (image_id != Py_None) {
+        id = qstring_from_pyobject_arg(image_id);
+        if (id.isNull()) {
+            return NULL;
+        }
+    }
+
+    QString provider;
+    if (name != Py_None && !image_provider_name(name, &provider)) {
+        return NULL;
+    }
+
+    // Cached images might hold Python objects, whose release needs the GIL
+    Py_BEGIN_ALLOW_THREADS
+    priv->invalidateImages(id, provider);
+    Py_END_ALLOW_THREADS
+
+    Py_RETURN_NONE;
+}
+
+PyObject *
+pyotherside_set_image_cache_size(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    static const char *kwlist[] = {"max_bytes", "name", NULL};
+    int max_bytes = 0;
+    PyObject *name = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "i|O:set_image_cache_size",
+                (char **)kwlist, &max_bytes, &name)) {
+        return NULL;
+    }
+
+    if (max_bytes < 0) {
+        PyErr_SetString(PyExc_ValueError, "Cache size must not be negative");
+        return NULL;
+    }
+
+    QString provider;
+    if (!image_provider_name(name, &provider)) {
+        return NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    {
+        QMutexLocker lock(&priv->image_cache_mutex);
+        priv->imageCache(provider)->images.setMaxCost(max_bytes);
+    }
+    Py_END_ALLOW_THREADS
+
+    Py_RETURN_NONE;
+}
+
+PyObject *
+pyotherside_image_cache_stats(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    static const char *kwlist[] = {"name", NULL};
+    PyObject *name = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|O:image_cache_stats",
+                (char **)kwlist, &name)) {
+        return NULL;
+    }
+
+    QString provider;
+    if (!image_provider_name(name, &provider)) {
+        return NULL;
+    }
+
+    int hits, misses, size, max_size, count;
+
+    Py_BEGIN_ALLOW_THREADS
+    {
+        QMutexLocker lock(&priv->image_cache_mutex);
+        QPythonPriv::ImageCache *cache = priv->imageCache(provider);
+        hits = cache->hits;
+        misses = cache->misses;
+        size = cache->images.totalCost();
+        max_size = cache->images.maxCost();
+        count = cache->images.count();
+    }
+    Py_END_ALLOW_THREADS
+
+    return Py_BuildValue("{sisisisisi}", "hits", hits, "misses", misses,
+            "size", size, "max_size", max_size, "count", count);
+}
+
+PyObject *
+pyotherside_set_svg_cache_size(PyObject *self, PyObject *args)
 {
-    priv->image_provider = PyObjectRef(o);
+    int max_bytes = 0;
+    if (!PyArg_ParseTuple(args, "i", &max_bytes)) {
+        return NULL;
+    }
+
+    if (max_bytes < 0) {
+        PyErr_SetString(PyExc_ValueError, "Cache size must not be negative");
+        return NULL;
+    }
+
+    // Parsed SVG documents don't hold Python objects, no need to drop the GIL
+    QMutexLocker lock(&priv->svg_cache_mutex);
+    priv->svg_cache.setMaxCost(max_bytes);
 
     Py_RETURN_NONE;
 }
 
+PyObject *
+pyotherside_svg_cache_stats(PyObject *self, PyObject *unused)
+{
+    QMutexLocker lock(&priv->svg_cache_mutex);
+    return Py_BuildValue("{sisisisisi}", "hits", priv->svg_cache_hits,
+            "misses", priv->svg_cache_misses,
+            "size", priv->svg_cache.totalCost(),
+            "max_size", priv->svg_cache.maxCost(),
+            "count", priv->svg_cache.count());
+}
+
 PyObject *
 pyotherside_qrc_is_file(PyObject *self, PyObject *filename)
 {
@@ -169,26 +463,657 @@ pyotherside_qrc_get_file_contents(PyObject *self, PyObject *filename)
         return NULL;
     }
 
-    QByteArray ba = file.readAll();
-    return PyByteArray_FromStringAndSize(ba.constData(), ba.size());
+    QByteArray ba = file.readAll();
+    return PyByteArray_FromStringAndSize(ba.constData(), ba.size());
+}
+
+PyObject *
+pyotherside_qrc_list_dir(PyObject *self, PyObject *dirname)
+{
+    QString qdirname = qstring_from_pyobject_arg(dirname);
+
+    if (qdirname.isNull()) {
+        return NULL;
+    }
+
+    QDir dir(":" + qdirname);
+    if (!dir.exists()) {
+        PyErr_SetString(PyExc_ValueError, "Directory not found");
+        return NULL;
+    }
+
+    return convertQVariantToPyObject(dir.entryList());
+}
+
+static bool
+qresource_is_compressed(const QResource &resource)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 13, 0)
+    return resource.compressionAlgorithm() != QResource::NoCompression;
+#else
+    return resource.isCompressed();
+#endif
+}
+
+PyObject *
+pyotherside_qrc_map(PyObject *self, PyObject *filename)
+{
+    QString qfilename = qstring_from_pyobject_arg(filename);
+
+    if (qfilename.isNull()) {
+        return NULL;
+    }
+
+    QResource resource(":" + qfilename);
+    if (!resource.isValid() || resource.isDir()) {
+        PyErr_SetString(PyExc_ValueError, "File not found");
+        return NULL;
+    }
+
+    if (!qresource_is_compressed(resource) && resource.data() != NULL) {
+        // Directly over the resource data, which stays mapped as long as
+        // the resource is registered (for compiled-in resources: forever)
+        return PyMemoryView_FromMemory((char *)resource.data(), resource.size(), PyBUF_READ);
+    }
+
+    // Decompress straight into a bytes object, which the view then owns
+    QFile file(":" + qfilename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        PyErr_SetString(PyExc_ValueError, "File not found");
+        return NULL;
+    }
+
+    PyObjectRef bytes(PyBytes_FromStringAndSize(NULL, file.size()), true);
+    if (!bytes) {
+        return NULL;
+    }
+
+    if (file.read(PyBytes_AS_STRING(bytes.borrow()), file.size()) != file.size()) {
+        PyErr_SetString(PyExc_OSError, "Could not read resource");
+        return NULL;
+    }
+
+    return PyMemoryView_FromObject(bytes.borrow());
+}
+
+PyObject *
+pyotherside_qrc_open(PyObject *self, PyObject *filename)
+{
+    QString qfilename = qstring_from_pyobject_arg(filename);
+
+    if (qfilename.isNull()) {
+        return NULL;
+    }
+
+    return QPythonPriv::openResource(":" + qfilename);
+}
+
+static pyotherside_QResourceFile *
+qresourcefile_check(PyObject *o)
+{
+    pyotherside_QResourceFile *self = (pyotherside_QResourceFile *)o;
+    if (self->file == NULL) {
+        PyErr_SetString(PyExc_ValueError, "I/O operation on closed file");
+        return NULL;
+    }
+
+    return self;
+}
+
+void
+pyotherside_QResourceFile_dealloc(pyotherside_QResourceFile *self)
+{
+    delete self->file;
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+PyObject *
+pyotherside_QResourceFile_readinto(PyObject *o, PyObject *buffer)
+{
+    pyotherside_QResourceFile *self = qresourcefile_check(o);
+    if (self == NULL) {
+        return NULL;
+    }
+
+    Py_buffer view;
+    if (PyObject_GetBuffer(buffer, &view, PyBUF_WRITABLE) != 0) {
+        return NULL;
+    }
+
+    qint64 result;
+    Py_BEGIN_ALLOW_THREADS
+    result = self->file->read((char *)view.buf, view.len);
+    Py_END_ALLOW_THREADS
+
+    PyBuffer_Release(&view);
+
+    if (result < 0) {
+        PyErr_SetString(PyExc_OSError, "Could not read resource");
+        return NULL;
+    }
+
+    return PyLong_FromLongLong(result);
+}
+
+PyObject *
+pyotherside_QResourceFile_read(PyObject *o, PyObject *args)
+{
+    pyotherside_QResourceFile *self = qresourcefile_check(o);
+    if (self == NULL) {
+        return NULL;
+    }
+
+    Py_ssize_t size = -1;
+    if (!PyArg_ParseTuple(args, "|n", &size)) {
+        return NULL;
+    }
+
+    qint64 available = qMax(qint64(0), self->file->size() - self->file->pos());
+    if (size < 0 || size > available) {
+        size = available;
+    }
+
+    PyObjectRef bytes(PyBytes_FromStringAndSize(NULL, size), true);
+    if (!bytes) {
+        return NULL;
+    }
+
+    qint64 result;
+    Py_BEGIN_ALLOW_THREADS
+    result = self->file->read(PyBytes_AS_STRING(bytes.borrow()), size);
+    Py_END_ALLOW_THREADS
+
+    if (result != size) {
+        PyErr_SetString(PyExc_OSError, "Could not read resource");
+        return NULL;
+    }
+
+    return bytes.newRef();
+}
+
+PyObject *
+pyotherside_QResourceFile_seek(PyObject *o, PyObject *args)
+{
+    pyotherside_QResourceFile *self = qresourcefile_check(o);
+    if (self == NULL) {
+        return NULL;
+    }
+
+    long long offset;
+    int whence = 0;
+    if (!PyArg_ParseTuple(args, "L|i", &offset, &whence)) {
+        return NULL;
+    }
+
+    qint64 pos;
+    switch (whence) {
+        case 0:
+            pos = offset;
+            break;
+        case 1:
+            pos = self->file->pos() + offset;
+            break;
+        case 2:
+            pos = self->file->size() + offset;
+            break;
+        default:
+            return PyErr_Format(PyExc_ValueError, "Invalid whence (%d)", whence);
+    }
+
+    if (pos < 0 || !self->file->seek(pos)) {
+        return PyErr_Format(PyExc_OSError, "Cannot seek to %lld", (long long)pos);
+    }
+
+    return PyLong_FromLongLong(self->file->pos());
+}
+
+PyObject *
+pyotherside_QResourceFile_tell(PyObject *o, PyObject *unused)
+{
+    pyotherside_QResourceFile *self = qresourcefile_check(o);
+    if (self == NULL) {
+        return NULL;
+    }
+
+    return PyLong_FromLongLong(self->file->pos());
+}
+
+PyObject *
+pyotherside_QResourceFile_true(PyObject *o, PyObject *unused)
+{
+    if (qresourcefile_check(o) == NULL) {
+        return NULL;
+    }
+
+    Py_RETURN_TRUE;
+}
+
+PyObject *
+pyotherside_QResourceFile_false(PyObject *o, PyObject *unused)
+{
+    if (qresourcefile_check(o) == NULL) {
+        return NULL;
+    }
+
+    Py_RETURN_FALSE;
+}
+
+PyObject *
+pyotherside_QResourceFile_none(PyObject *o, PyObject *unused)
+{
+    Py_RETURN_NONE;
+}
+
+PyObject *
+pyotherside_QResourceFile_close(PyObject *o, PyObject *unused)
+{
+    pyotherside_QResourceFile *self = (pyotherside_QResourceFile *)o;
+    delete self->file;
+    self->file = NULL;
+
+    Py_RETURN_NONE;
+}
+
+PyObject *
+pyotherside_QResourceFile_closed(PyObject *o, void *closure)
+{
+    return PyBool_FromLong(((pyotherside_QResourceFile *)o)->file == NULL);
+}
+
+static PyMethodDef pyotherside_QResourceFileMethods[] = {
+    {"read", pyotherside_QResourceFile_read, METH_VARARGS, NULL},
+    {"readinto", pyotherside_QResourceFile_readinto, METH_O, NULL},
+    {"seek", pyotherside_QResourceFile_seek, METH_VARARGS, NULL},
+    {"tell", pyotherside_QResourceFile_tell, METH_NOARGS, NULL},
+    {"readable", pyotherside_QResourceFile_true, METH_NOARGS, NULL},
+    {"seekable", pyotherside_QResourceFile_true, METH_NOARGS, NULL},
+    {"writable", pyotherside_QResourceFile_false, METH_NOARGS, NULL},
+    {"isatty", pyotherside_QResourceFile_false, METH_NOARGS, NULL},
+    {"flush", pyotherside_QResourceFile_none, METH_NOARGS, NULL},
+    {"close", pyotherside_QResourceFile_close, METH_NOARGS, NULL},
+
+    /* sentinel */
+    {NULL, NULL, 0, NULL},
+};
+
+static PyGetSetDef pyotherside_QResourceFileGetSet[] = {
+    {(char *)"closed", pyotherside_QResourceFile_closed, NULL, NULL, NULL},
+
+    /* sentinel */
+    {NULL, NULL, NULL, NULL, NULL},
+};
+
+static bool
+qresourcefile_type_ready()
+{
+    // Also used by the open_code hook for pythonlib.zip, which runs while
+    // the standard library is imported, before PyOtherSide_init()
+    if (PyType_HasFeature(&pyotherside_QResourceFileType, Py_TPFLAGS_READY)) {
+        return true;
+    }
+
+    pyotherside_QResourceFileType.tp_dealloc = (destructor)pyotherside_QResourceFile_dealloc;
+    pyotherside_QResourceFileType.tp_methods = pyotherside_QResourceFileMethods;
+    pyotherside_QResourceFileType.tp_getset = pyotherside_QResourceFileGetSet;
+    return (PyType_Ready(&pyotherside_QResourceFileType) == 0);
+}
+
+PyObject *
+QPythonPriv::openResource(const QString &path)
+{
+    if (!qresourcefile_type_ready()) {
+        return NULL;
+    }
+
+    QFile *file = new QFile(path);
+    if (!file->exists() || !file->open(QIODevice::ReadOnly)) {
+        delete file;
+        PyErr_SetString(PyExc_ValueError, "File not found");
+        return NULL;
+    }
+
+    pyotherside_QResourceFile *raw = PyObject_New(pyotherside_QResourceFile,
+            &pyotherside_QResourceFileType);
+    if (raw == NULL) {
+        delete file;
+        return NULL;
+    }
+    raw->file = file;
+
+    // _io instead of io, as the io module might not be importable yet
+    PyObjectRef raw_ref((PyObject *)raw, true);
+    PyObjectRef io(PyImport_ImportModule("_io"), true);
+    if (!io) {
+        return NULL;
+    }
+
+    return PyObject_CallMethod(io.borrow(), "BufferedReader", "O", raw_ref.borrow());
+}
+
+PyObject *
+pyotherside_acquire_frame(PyObject *self, PyObject *name)
+{
+    QString qname = qstring_from_pyobject_arg(name);
+
+    if (qname.isNull()) {
+        return NULL;
+    }
+
+    QSharedPointer<QPythonFrameRing> ring = QPythonFrameRing::find(qname);
+    if (!ring) {
+        // No PyFrameStream with this name (yet)
+        Py_RETURN_NONE;
+    }
+
+    int index = ring->acquire();
+    if (index == -1) {
+        PyErr_SetString(PyExc_RuntimeError, "All frame buffers are in use");
+        return NULL;
+    }
+
+    pyotherside_FrameBuffer *frame = PyObject_New(pyotherside_FrameBuffer,
+            &pyotherside_FrameBufferType);
+    if (frame == NULL) {
+        ring->release(index);
+        return NULL;
+    }
+
+    frame->ring = new QSharedPointer<QPythonFrameRing>(ring);
+    frame->index = index;
+    frame->exports = 0;
+    frame->width = ring->size().width();
+    frame->height = ring->size().height();
+    frame->bytes_per_line = ring->bytesPerLine();
+    frame->format = ring->format();
+
+    return (PyObject *)frame;
+}
+
+PyObject *
+pyotherside_commit_frame(PyObject *self, PyObject *o)
+{
+    if (!PyObject_TypeCheck(o, &pyotherside_FrameBufferType)) {
+        PyErr_SetString(PyExc_TypeError, "Argument must be a frame from acquire_frame()");
+        return NULL;
+    }
+
+    pyotherside_FrameBuffer *frame = (pyotherside_FrameBuffer *)o;
+    if (frame->ring == NULL) {
+        PyErr_SetString(PyExc_ValueError, "Frame was already committed");
+        return NULL;
+    }
+
+    // Views keep the frame object (and so the ring) alive, but must not
+    // write into the buffer once it can be shown or reused
+    if (frame->exports > 0) {
+        PyErr_SetString(PyExc_BufferError,
+                "Frame is still in use (release all memoryviews and arrays first)");
+        return NULL;
+    }
+
+    (*frame->ring)->commit(frame->index);
+    delete frame->ring;
+    frame->ring = NULL;
+
+    Py_RETURN_NONE;
+}
+
+void
+pyotherside_FrameBuffer_dealloc(pyotherside_FrameBuffer *self)
+{
+    if (self->ring != NULL) {
+        // Never committed, the buffer can be used for another frame
+        (*self->ring)->release(self->index);
+        delete self->ring;
+    }
+
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+int
+pyotherside_FrameBuffer_getbuffer(PyObject *o, Py_buffer *view, int flags)
+{
+    pyotherside_FrameBuffer *self = (pyotherside_FrameBuffer *)o;
+    if (self->ring == NULL) {
+        view->obj = NULL;
+        PyErr_SetString(PyExc_ValueError, "Frame was already committed");
+        return -1;
+    }
+
+    QPythonFrameRing *ring = self->ring->data();
+    if (PyBuffer_FillInfo(view, o, ring->bits(self->index), ring->byteCount(), 0, flags) < 0) {
+        return -1;
+    }
+
+    self->exports++;
+    return 0;
+}
+
+void
+pyotherside_FrameBuffer_releasebuffer(PyObject *o, Py_buffer *view)
+{
+    ((pyotherside_FrameBuffer *)o)->exports--;
+}
+
+PyObject *
+pyotherside_FrameBuffer_size(PyObject *o, void *closure)
+{
+    pyotherside_FrameBuffer *self = (pyotherside_FrameBuffer *)o;
+    return Py_BuildValue("(ii)", self->width, self->height);
+}
+
+PyObject *
+pyotherside_FrameBuffer_bytes_per_line(PyObject *o, void *closure)
+{
+    return PyLong_FromLong(((pyotherside_FrameBuffer *)o)->bytes_per_line);
+}
+
+PyObject *
+pyotherside_FrameBuffer_format(PyObject *o, void *closure)
+{
+    return PyLong_FromLong(((pyotherside_FrameBuffer *)o)->format);
+}
+
+static PyBufferProcs pyotherside_FrameBufferBuffer = {
+    pyotherside_FrameBuffer_getbuffer, /* bf_getbuffer */
+    pyotherside_FrameBuffer_releasebuffer, /* bf_releasebuffer */
+};
+
+static PyGetSetDef pyotherside_FrameBufferGetSet[] = {
+    {(char *)"size", pyotherside_FrameBuffer_size, NULL, NULL, NULL},
+    {(char *)"bytes_per_line", pyotherside_FrameBuffer_bytes_per_line, NULL, NULL, NULL},
+    {(char *)"format", pyotherside_FrameBuffer_format, NULL, NULL, NULL},
+
+    /* sentinel */
+    {NULL, NULL, NULL, NULL, NULL},
+};
+
+static bool
+dont_write_bytecode()
+{
+    PyObject *flag = PySys_GetObject((char *)"dont_write_bytecode");
+    return flag && PyObject_IsTrue(flag) == 1;
+}
+
+/**
+ * Compile Python source loaded from Qt Resources. Compiled code objects are
+ * cached (marshalled) in the application's cache directory, so that modules
+ * don't have to be recompiled on every application start. There is one
+ * cache file per filename, which starts with a hash of the filename, the
+ * source and the bytecode version of the running Python; a stale file is
+ * overwritten, so the cache doesn't grow with every update of the sources.
+ **/
+static PyObject *
+compile_qrc_source(const QByteArray &source, const QString &filename)
+{
+    QByteArray fn = filename.toUtf8();
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArray::number((qlonglong)PyImport_GetMagicNumber()));
+    hash.addData(fn);
+    hash.addData(source);
+    QByteArray key = hash.result();
+
+    static QString cache_dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    QString cache_file;
+    if (!cache_dir.isEmpty()) {
+        cache_file = QDir(cache_dir).filePath("pyotherside-bytecode/" +
+                QString::fromLatin1(QCryptographicHash::hash(fn, QCryptographicHash::Sha1).toHex()) +
+                ".pyc");
+
+        QFile cached(cache_file);
+        if (cached.open(QIODevice::ReadOnly) && cached.read(key.size()) == key) {
+            QByteArray data = cached.readAll();
+            PyObject *code = PyMarshal_ReadObjectFromString(data.constData(), data.size());
+            if (code && PyCode_Check(code)) {
+                return code;
+            }
+
+            // Corrupt cache file, will be overwritten below
+            Py_XDECREF(code);
+            PyErr_Clear();
+        }
+    }
+
+    PyObject *code = Py_CompileString(source.constData(), fn.constData(), Py_file_input);
+    if (code == NULL) {
+        return NULL;
+    }
+
+    if (!cache_file.isEmpty() && !dont_write_bytecode()) {
+        PyObjectRef data(PyMarshal_WriteObjectToString(code, Py_MARSHAL_VERSION), true);
+        if (data) {
+            QDir().mkpath(QFileInfo(cache_file).path());
+            QSaveFile out(cache_file);
+            if (out.open(QIODevice::WriteOnly)) {
+                out.write(key);
+                out.write(PyBytes_AS_STRING(data.borrow()), PyBytes_GET_SIZE(data.borrow()));
+                out.commit();
+            }
+        } else {
+            PyErr_Clear();
+        }
+    }
+
+    return code;
+}
+
+PyObject *
+pyotherside_qrc_compile(PyObject *self, PyObject *filename)
+{
+    QString qfilename = qstring_from_pyobject_arg(filename);
+
+    if (qfilename.isNull()) {
+        return NULL;
+    }
+
+    QFile file(":" + qfilename);
+    if (!file.exists() || !file.open(QIODevice::ReadOnly)) {
+        PyErr_SetString(PyExc_ValueError, "File not found");
+        return NULL;
+    }
+
+    return compile_qrc_source(file.readAll(), "qrc:" + qfilename);
+}
+
+// Index of Python modules in Qt Resources (module name -> "qrc:" filename)
+// for the "qrc:" entries in sys.path, used by the qrc importer; protected
+// by the GIL, and rebuilt when the "qrc:" entries in sys.path change
+static QStringList qrc_index_roots;
+static QHash<QString, QString> qrc_index;
+
+static void
+qrc_index_add_root(const QString &import_path)
+{
+    QDir dir(":" + import_path.mid(4));
+    QHash<QString, QString> modules;
+
+    QDirIterator it(dir.path(), QStringList() << "*.py", QDir::Files,
+            QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        QString relative = it.next().mid(dir.path().length());
+        if (relative.startsWith("/")) {
+            relative = relative.mid(1);
+        }
+
+        QString name = relative.left(relative.length() - 3);
+        bool package = (name == "__init__" || name.endsWith("/__init__"));
+        if (package) {
+            name.chop(9);
+            if (name.isEmpty()) {
+                continue;
+            }
+        }
+        name.replace('/', '.');
+
+        // "foo.py" takes precedence over "foo/__init__.py"
+        if (package && modules.contains(name)) {
+            continue;
+        }
+
+        modules.insert(name, import_path + "/" + relative);
+    }
+
+    // Earlier entries in sys.path take precedence
+    QHash<QString, QString>::const_iterator i;
+    for (i=modules.constBegin(); i!=modules.constEnd(); ++i) {
+        if (!qrc_index.contains(i.key())) {
+            qrc_index.insert(i.key(), i.value());
+        }
+    }
+}
+
+PyObject *
+pyotherside_qrc_find_module(PyObject *self, PyObject *fullname)
+{
+    QString qfullname = qstring_from_pyobject_arg(fullname);
+
+    if (qfullname.isNull()) {
+        return NULL;
+    }
+
+    QStringList roots;
+    PyObject *path = PySys_GetObject((char *)"path");
+    if (path && PyList_Check(path)) {
+        for (Py_ssize_t i=0; i<PyList_GET_SIZE(path); i++) {
+            PyObject *entry = PyList_GET_ITEM(path, i);
+            if (!PyUnicode_Check(entry)) {
+                continue;
+            }
+
+            const char *utf8 = PyUnicode_AsUTF8(entry);
+            if (utf8 == NULL) {
+                PyErr_Clear();
+            } else if (strncmp(utf8, "qrc:", 4) == 0) {
+                roots << QString::fromUtf8(utf8);
+            }
+        }
+    }
+
+    if (roots != qrc_index_roots) {
+        qrc_index.clear();
+        for (int i=0; i<roots.size(); i++) {
+            qrc_index_add_root(roots[i]);
+        }
+        qrc_index_roots = roots;
+    }
+
+    QHash<QString, QString>::const_iterator it = qrc_index.constFind(qfullname);
+    if (it == qrc_index.constEnd()) {
+        Py_RETURN_NONE;
+    }
+
+    return PyUnicode_FromString(it.value().toUtf8().constData());
 }
 
 PyObject *
-pyotherside_qrc_list_dir(PyObject *self, PyObject *dirname)
+pyotherside_qrc_invalidate_index(PyObject *self, PyObject *unused)
 {
-    QString qdirname = qstring_from_pyobject_arg(dirname);
-
-    if (qdirname.isNull()) {
-        return NULL;
-    }
-
-    QDir dir(":" + qdirname);
-    if (!dir.exists()) {
-        PyErr_SetString(PyExc_ValueError, "Directory not found");
-        return NULL;
-    }
+    // Rebuilt on the next lookup (e.g. after registering new resources)
+    qrc_index_roots.clear();
+    qrc_index.clear();
 
-    return convertQVariantToPyObject(dir.entryList());
+    Py_RETURN_NONE;
 }
 
 void
@@ -447,7 +1372,7 @@ static PyMethodDef PyOtherSideMethods[] = {
     {"atexit", pyotherside_atexit, METH_O, "Function to call on shutdown."},
 
     /* Introduced in PyOtherSide 1.1 */
-    {"set_image_provider", pyotherside_set_image_provider, METH_O, "Set the QML image provider."},
+    {"set_image_provider", (PyCFunction)(void(*)(void))pyotherside_set_image_provider, METH_VARARGS | METH_KEYWORDS, "Set the QML image provider."},
 
     /* Introduced in PyOtherSide 1.3 */
     {"qrc_is_file", pyotherside_qrc_is_file, METH_O, "Check if a file exists in Qt Resources."},
@@ -455,6 +1380,20 @@ static PyMethodDef PyOtherSideMethods[] = {
     {"qrc_get_file_contents", pyotherside_qrc_get_file_contents, METH_O, "Get file contents from a Qt Resource."},
     {"qrc_list_dir", pyotherside_qrc_list_dir, METH_O, "Get directory entries from a Qt Resource."},
 
+    /* Introduced in PyOtherSide 1.7 */
+    {"invalidate_image", (PyCFunction)(void(*)(void))pyotherside_invalidate_image, METH_VARARGS | METH_KEYWORDS, "Drop cached images from the image provider."},
+    {"set_image_cache_size", (PyCFunction)(void(*)(void))pyotherside_set_image_cache_size, METH_VARARGS | METH_KEYWORDS, "Set the image cache size of an image provider in bytes."},
+    {"image_cache_stats", (PyCFunction)(void(*)(void))pyotherside_image_cache_stats, METH_VARARGS | METH_KEYWORDS, "Get image cache statistics of an image provider."},
+    {"set_svg_cache_size", pyotherside_set_svg_cache_size, METH_VARARGS, "Set the parsed SVG document cache size in bytes."},
+    {"svg_cache_stats", pyotherside_svg_cache_stats, METH_NOARGS, "Get parsed SVG document cache statistics."},
+    {"qrc_find_module", pyotherside_qrc_find_module, METH_O, "Find the qrc: filename of a module in sys.path."},
+    {"qrc_invalidate_index", pyotherside_qrc_invalidate_index, METH_NOARGS, "Rescan qrc: entries in sys.path."},
+    {"qrc_compile", pyotherside_qrc_compile, METH_O, "Compile a Python file from Qt Resources (cached)."},
+    {"qrc_map", pyotherside_qrc_map, METH_O, "Get a read-only memoryview of a file in Qt Resources."},
+    {"qrc_open", pyotherside_qrc_open, METH_O, "Open a file in Qt Resources for reading."},
+    {"acquire_frame", pyotherside_acquire_frame, METH_O, "Get a free frame buffer of a PyFrameStream."},
+    {"commit_frame", pyotherside_commit_frame, METH_O, "Show a filled frame buffer in its PyFrameStream."},
+
     /* sentinel */
     {NULL, NULL, 0, NULL},
 };
@@ -484,6 +1423,47 @@ PyOtherSide_init()
     PyModule_AddIntConstant(pyotherside, "format_rgb888", QImage::Format_RGB888);
     PyModule_AddIntConstant(pyotherside, "format_rgb444", QImage::Format_RGB444);
 
+    // Additional formats (new in 1.7), availability depends on the Qt version
+    PyModule_AddIntConstant(pyotherside, "format_argb32_premultiplied", QImage::Format_ARGB32_Premultiplied);
+    PyModule_AddIntConstant(pyotherside, "format_argb8565_premultiplied", QImage::Format_ARGB8565_Premultiplied);
+    PyModule_AddIntConstant(pyotherside, "format_argb6666_premultiplied", QImage::Format_ARGB6666_Premultiplied);
+    PyModule_AddIntConstant(pyotherside, "format_argb8555_premultiplied", QImage::Format_ARGB8555_Premultiplied);
+    PyModule_AddIntConstant(pyotherside, "format_argb4444_premultiplied", QImage::Format_ARGB4444_Premultiplied);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 2, 0)
+    PyModule_AddIntConstant(pyotherside, "format_rgbx8888", QImage::Format_RGBX8888);
+    PyModule_AddIntConstant(pyotherside, "format_rgba8888", QImage::Format_RGBA8888);
+    PyModule_AddIntConstant(pyotherside, "format_rgba8888_premultiplied", QImage::Format_RGBA8888_Premultiplied);
+#endif
+#if QT_VERSION >= QT_VERSION_CHECK(5, 4, 0)
+    PyModule_AddIntConstant(pyotherside, "format_bgr30", QImage::Format_BGR30);
+    PyModule_AddIntConstant(pyotherside, "format_a2bgr30_premultiplied", QImage::Format_A2BGR30_Premultiplied);
+    PyModule_AddIntConstant(pyotherside, "format_rgb30", QImage::Format_RGB30);
+    PyModule_AddIntConstant(pyotherside, "format_a2rgb30_premultiplied", QImage::Format_A2RGB30_Premultiplied);
+#endif
+#if QT_VERSION >= QT_VERSION_CHECK(5, 5, 0)
+    PyModule_AddIntConstant(pyotherside, "format_alpha8", QImage::Format_Alpha8);
+    PyModule_AddIntConstant(pyotherside, "format_grayscale8", QImage::Format_Grayscale8);
+#endif
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+    PyModule_AddIntConstant(pyotherside, "format_rgbx64", QImage::Format_RGBX64);
+    PyModule_AddIntConstant(pyotherside, "format_rgba64", QImage::Format_RGBA64);
+    PyModule_AddIntConstant(pyotherside, "format_rgba64_premultiplied", QImage::Format_RGBA64_Premultiplied);
+#endif
+#if QT_VERSION >= QT_VERSION_CHECK(5, 13, 0)
+    PyModule_AddIntConstant(pyotherside, "format_grayscale16", QImage::Format_Grayscale16);
+#endif
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    PyModule_AddIntConstant(pyotherside, "format_bgr888", QImage::Format_BGR888);
+#endif
+#if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
+    PyModule_AddIntConstant(pyotherside, "format_rgbx16fpx4", QImage::Format_RGBX16FPx4);
+    PyModule_AddIntConstant(pyotherside, "format_rgba16fpx4", QImage::Format_RGBA16FPx4);
+    PyModule_AddIntConstant(pyotherside, "format_rgba16fpx4_premultiplied", QImage::Format_RGBA16FPx4_Premultiplied);
+    PyModule_AddIntConstant(pyotherside, "format_rgbx32fpx4", QImage::Format_RGBX32FPx4);
+    PyModule_AddIntConstant(pyotherside, "format_rgba32fpx4", QImage::Format_RGBA32FPx4);
+    PyModule_AddIntConstant(pyotherside, "format_rgba32fpx4_premultiplied", QImage::Format_RGBA32FPx4_Premultiplied);
+#endif
+
     // Custom constant - pixels are to be interpreted as encoded image file data
     PyModule_AddIntConstant(pyotherside, "format_data", PYOTHERSIDE_IMAGE_FORMAT_ENCODED);
     PyModule_AddIntConstant(pyotherside, "format_svg_data", PYOTHERSIDE_IMAGE_FORMAT_SVG);
@@ -517,61 +1497,392 @@ PyOtherSide_init()
     Py_INCREF(&pyotherside_QObjectMethodType);
     PyModule_AddObject(pyotherside, "QObjectMethod", (PyObject *)(&pyotherside_QObjectMethodType));
 
+    // Readers for qrc_open() (new in 1.7)
+    if (!qresourcefile_type_ready()) {
+        qFatal("Could not initialize QResourceFileType");
+        // Not reached
+        return NULL;
+    }
+
+    // Frame buffers for acquire_frame() (new in 1.7)
+    pyotherside_FrameBufferType.tp_dealloc = (destructor)pyotherside_FrameBuffer_dealloc;
+    pyotherside_FrameBufferType.tp_as_buffer = &pyotherside_FrameBufferBuffer;
+    pyotherside_FrameBufferType.tp_getset = pyotherside_FrameBufferGetSet;
+    if (PyType_Ready(&pyotherside_FrameBufferType) < 0) {
+        qFatal("Could not initialize FrameBufferType");
+        // Not reached
+        return NULL;
+    }
+
     return pyotherside;
 }
 
+static bool
+startup_option(const char *name)
+{
+    QByteArray value = qgetenv(name);
+    return !value.isEmpty() && value != "0" && value != "off";
+}
+
+static void
+check_config_status(PyStatus status, PyConfig *config)
+{
+    if (PyStatus_Exception(status)) {
+        PyConfig_Clear(config);
+        qFatal("Invalid Python configuration: %s",
+               status.err_msg ? status.err_msg : "unknown error");
+    }
+}
+
+static void
+pre_initialize(bool isolated)
+{
+    PyPreConfig preconfig;
+    if (isolated) {
+        PyPreConfig_InitIsolatedConfig(&preconfig);
+    } else {
+        // Like Py_InitializeEx(): no C locale coercion (PEP 538) and no
+        // UTF-8 mode (PEP 540), which change the whole process
+        PyPreConfig_InitPythonConfig(&preconfig);
+        preconfig.parse_argv = 0;
+        preconfig.coerce_c_locale = 0;
+        preconfig.coerce_c_locale_warn = 0;
+#if PY_VERSION_HEX < 0x030F0000
+        // The default from Python 3.15 on (PEP 686)
+        preconfig.utf8_mode = 0;
+#endif
+    }
+
+    PyStatus status = Py_PreInitialize(&preconfig);
+    if (PyStatus_Exception(status)) {
+        qFatal("Could not pre-initialize Python: %s",
+               status.err_msg ? status.err_msg : "unknown error");
+    }
+}
+
+static void
+init_config(PyConfig *config, bool isolated)
+{
+    if (isolated) {
+        PyConfig_InitIsolatedConfig(config);
+    } else {
+        PyConfig_InitPythonConfig(config);
+        // Like Py_InitializeEx(), stdin/stdout/stderr stay as they are
+        config->configure_c_stdio = 0;
+    }
+
+    // Like Py_InitializeEx(0), leave signal handling to Qt
+    config->install_signal_handlers = 0;
+
+    // Initialize sys.argv (https://github.com/thp/pyotherside/issues/77)
+    wchar_t *argv[] = { (wchar_t *)L"" };
+    config->parse_argv = 0;
+    check_config_status(PyConfig_SetArgv(config, 1, argv), config);
+
+    if (startup_option("PYOTHERSIDE_NO_SITE")) {
+        config->site_import = 0;
+    }
+
+    if (startup_option("PYOTHERSIDE_DONT_WRITE_BYTECODE")) {
+        config->write_bytecode = 0;
+    }
+
+    if (startup_option("PYOTHERSIDE_IMPORTTIME")) {
+        config->import_time = 1;
+    }
+
+#if PY_VERSION_HEX >= 0x030B0000
+    if (!qgetenv("PYOTHERSIDE_FROZEN_MODULES").isEmpty()) {
+        config->use_frozen_modules = startup_option("PYOTHERSIDE_FROZEN_MODULES");
+    }
+#endif
+
+#if defined(Q_OS_WIN)
+    QString delimiter(";");
+#else
+    QString delimiter(":");
+#endif
+
+    QStringList search_paths;
+    for (int i=0; i<module_search_paths.size(); i++) {
+        if (!is_resource_archive(module_search_paths[i])) {
+            search_paths << module_search_paths[i];
+        }
+    }
+
+    // Fixed sys.path, skips the search for the standard library
+    QString path = QString::fromUtf8(qgetenv("PYOTHERSIDE_PYTHONPATH"));
+    if (!path.isEmpty()) {
+        QStringList entries = search_paths + path.split(delimiter);
+        config->module_search_paths_set = 1;
+        for (int i=0; i<entries.size(); i++) {
+            if (entries[i].isEmpty()) {
+                continue;
+            }
+
+            std::wstring entry = entries[i].toStdWString();
+            check_config_status(PyWideStringList_Append(&config->module_search_paths,
+                        entry.c_str()), config);
+        }
+    } else if (!search_paths.isEmpty()) {
+        // Setting pythonpath_env stops Python from reading PYTHONPATH, and
+        // unlike PYTHONPATH, it is also used in isolated mode
+        QStringList entries = search_paths;
+        QString pythonpath = QString::fromUtf8(qgetenv("PYTHONPATH"));
+        if (config->use_environment && !pythonpath.isEmpty()) {
+            entries << pythonpath;
+        }
+
+        std::wstring entry = entries.join(delimiter).toStdWString();
+        check_config_status(PyConfig_SetString(config, &config->pythonpath_env,
+                    entry.c_str()), config);
+    }
+}
+
+class QPythonPrivInitThread : public QThread {
+    public:
+        QPythonPrivInitThread(QPythonPriv *priv)
+            : QThread()
+            , priv(priv)
+        {
+            setObjectName("QPythonInit");
+        }
+
+    protected:
+        virtual void run() { priv->importModules(); }
+
+    private:
+        QPythonPriv *priv;
+};
+
 QPythonPriv::QPythonPriv()
     : locals()
     , globals()
     , atexit_callback()
     , image_provider()
+    , image_providers()
     , traceback_mod()
     , pyotherside_mod()
     , thread_state(NULL)
+    , code_cache(256)
+    , image_cache_mutex()
+    , image_caches()
+    , svg_cache_mutex()
+    , svg_cache(1024 * 1024)
+    , svg_cache_hits(0)
+    , svg_cache_misses(0)
+    , init_state(NotStarted)
+    , init_mutex()
+    , init_condition()
 {
-    PyImport_AppendInittab("pyotherside", PyOtherSide_init);
+}
+
+void
+QPythonPriv::addModuleSearchPath(const QString &path)
+{
+    if (priv != NULL) {
+        qWarning() << "Python already started, not adding" << path << "to sys.path";
+        return;
+    }
 
-    Py_InitializeEx(0);
+    module_search_paths.prepend(path);
+}
 
-    // Initialize sys.argv (https://github.com/thp/pyotherside/issues/77)
-    int argc = 1;
-    wchar_t **argv = (wchar_t **)malloc(argc * sizeof(wchar_t *));
-    argv[0] = Py_DecodeLocale("", nullptr);
-    PySys_SetArgvEx(argc, argv, 0);
-    PyMem_RawFree((void *)argv[0]);
-    free(argv);
+QPythonPriv *
+QPythonPriv::start(bool background)
+{
+    if (priv == NULL) {
+        priv = new QPythonPriv;
+    }
+
+    QMutexLocker lock(&priv->init_mutex);
+    if (priv->init_state.loadAcquire() != NotStarted) {
+        return priv;
+    }
+    priv->init_state.storeRelease(Initializing);
+    lock.unlock();
+
+    // The interpreter itself is initialized on this thread, so that it is
+    // Python's main thread (signal.signal() can only be used there), and it
+    // stays alive until Python is finalized
+    priv->initialize();
+
+    if (background) {
+        QThread *thread = new QPythonPrivInitThread(priv);
+        QObject::connect(thread, SIGNAL(finished()),
+                         thread, SLOT(deleteLater()));
+        thread->start();
+    } else {
+        priv->importModules();
+    }
+
+    return priv;
+}
+
+bool
+QPythonPriv::isReady() const
+{
+    return init_state.loadAcquire() == Ready;
+}
+
+void
+QPythonPriv::waitForReady()
+{
+    if (isReady()) {
+        return;
+    }
 
-    locals = PyObjectRef(PyDict_New(), true);
-    assert(locals);
+    QMutexLocker lock(&init_mutex);
+    while (init_state.loadAcquire() != Ready) {
+        init_condition.wait(&init_mutex);
+    }
+}
+
+void
+QPythonPriv::initialize()
+{
+    PyImport_AppendInittab("pyotherside", PyOtherSide_init);
 
-    globals = PyObjectRef(PyDict_New(), true);
-    assert(globals);
+    // Before anything that might pre-initialize Python with its defaults
+    bool isolated = startup_option("PYOTHERSIDE_ISOLATED");
+    pre_initialize(isolated);
 
-    traceback_mod = PyObjectRef(PyImport_ImportModule("traceback"), true);
-    assert(traceback_mod);
+    PyConfig config;
+    init_config(&config, isolated);
+
+    QStringList archives;
+    for (int i=0; i<module_search_paths.size(); i++) {
+        if (is_resource_archive(module_search_paths[i])) {
+            archives << module_search_paths[i];
+        }
+    }
 
-    priv = this;
+#if PY_VERSION_HEX < 0x030E0000
+    // The importer for the archives is installed between the core and the
+    // main phase, as the main phase already imports modules (encodings)
+    if (!archives.isEmpty()) {
+        config._init_main = 0;
+    }
+#else
+    if (!archives.isEmpty()) {
+        qWarning() << "Importing from" << archives << "needs Python 3.13 or older";
+        archives.clear();
+    }
+#endif
 
-    if (PyDict_GetItemString(globals.borrow(), "__builtins__") == NULL) {
-        PyDict_SetItemString(globals.borrow(), "__builtins__",
-                PyEval_GetBuiltins());
+    PyStatus status = Py_InitializeFromConfig(&config);
+    PyConfig_Clear(&config);
+    if (PyStatus_Exception(status)) {
+        qFatal("Could not initialize Python: %s",
+               status.err_msg ? status.err_msg : "unknown error");
     }
 
-    // Need to "self-import" the pyotherside module here, so that Python code
-    // can use objects wrapped with pyotherside.QObject without crashing when
-    // the user's Python code doesn't "import pyotherside"
-    pyotherside_mod = PyObjectRef(PyImport_ImportModule("pyotherside"), true);
-    assert(pyotherside_mod);
+#if PY_VERSION_HEX < 0x030E0000
+    if (!archives.isEmpty()) {
+        installQrcZipImporter(archives);
+
+        status = _Py_InitializeMain();
+        if (PyStatus_Exception(status)) {
+            qFatal("Could not initialize Python: %s",
+                   status.err_msg ? status.err_msg : "unknown error");
+        }
+    }
+#endif
 
     // Release the GIL
     thread_state = PyEval_SaveThread();
 }
 
+void
+QPythonPriv::installQrcZipImporter(const QStringList &archives)
+{
+    QString filename = "/io/thp/pyotherside/qrc_zipimporter.py";
+    QFile source(":" + filename);
+    if (!source.open(QIODevice::ReadOnly)) {
+        qWarning() << "Cannot load qrc zip importer source";
+        return;
+    }
+
+    // Not through the bytecode cache of compile_qrc_source(), which needs
+    // the import system of the main phase (for the magic number), as does
+    // PyImport_ExecCodeModule()
+    QByteArray code = source.readAll();
+    QByteArray fn = QString("qrc:" + filename).toUtf8();
+    PyObjectRef co(Py_CompileString(code.constData(), fn.constData(),
+                Py_file_input), true);
+    if (!co) {
+        qWarning() << "Cannot compile qrc zip importer:" << formatExc();
+        return;
+    }
+
+    PyObjectRef module(PyModule_New("pyotherside.qrc_zipimporter"), true);
+    PyObject *dict = PyModule_GetDict(module.borrow());
+    PyDict_SetItemString(dict, "__builtins__", PyEval_GetBuiltins());
+
+    PyObjectRef result(PyEval_EvalCode(co.borrow(), dict, dict), true);
+    if (!result) {
+        qWarning() << "Cannot exec qrc zip importer:" << formatExc();
+        return;
+    }
+
+    static PyMethodDef qrc_open_def = {
+        "qrc_open", pyotherside_qrc_open, METH_O, NULL
+    };
+    PyObjectRef qrc_open(PyCFunction_New(&qrc_open_def, NULL), true);
+    PyObjectRef paths(convertQVariantToPyObject(archives), true);
+
+    result = PyObjectRef(PyObject_CallMethod(module.borrow(), "install", "OO",
+                paths.borrow(), qrc_open.borrow()), true);
+    if (!result) {
+        qWarning() << "Cannot install qrc zip importer:" << formatExc();
+    }
+}
+
+void
+QPythonPriv::importModules()
+{
+    {
+        // Takes most of the startup time after the interpreter is initialized
+        ENSURE_GIL_STATE;
+
+        locals = PyObjectRef(PyDict_New(), true);
+        assert(locals);
+
+        globals = PyObjectRef(PyDict_New(), true);
+        assert(globals);
+
+        traceback_mod = PyObjectRef(PyImport_ImportModule("traceback"), true);
+        assert(traceback_mod);
+
+        if (PyDict_GetItemString(globals.borrow(), "__builtins__") == NULL) {
+            PyDict_SetItemString(globals.borrow(), "__builtins__",
+                    PyEval_GetBuiltins());
+        }
+
+        // Need to "self-import" the pyotherside module here, so that Python code
+        // can use objects wrapped with pyotherside.QObject without crashing when
+        // the user's Python code doesn't "import pyotherside"
+        pyotherside_mod = PyObjectRef(PyImport_ImportModule("pyotherside"), true);
+        assert(pyotherside_mod);
+    }
+
+    init_mutex.lock();
+    init_state.storeRelease(Ready);
+    init_condition.wakeAll();
+    init_mutex.unlock();
+
+    emit ready();
+}
+
 QPythonPriv::~QPythonPriv()
 {
     // Re-acquire the previously-released GIL
     PyEval_RestoreThread(thread_state);
 
+    // Cached images might still hold Python pixel data
+    qDeleteAll(image_caches);
+    image_caches.clear();
+
     Py_Finalize();
 }
 
@@ -662,6 +1973,33 @@ QPythonPriv::eval(QString expr)
     return result;
 }
 
+PyObject *
+QPythonPriv::evalCached(QString expr)
+{
+    // Only the compiled expression is cached, not the object it evaluates to.
+    // Names are still looked up in globals on every evaluation, so modules
+    // imported (or attributes replaced) after the first call are picked up.
+    PyObjectRef code;
+
+    PyObjectRef *cached = code_cache.object(expr);
+    if (cached) {
+        // Keep our own reference, the cache entry might be evicted by another
+        // thread while the GIL is released during evaluation
+        code = *cached;
+    } else {
+        QByteArray utf8bytes = expr.toUtf8();
+        code = PyObjectRef(Py_CompileString(utf8bytes.constData(), "<string>",
+                    Py_eval_input), true);
+        if (!code) {
+            return NULL;
+        }
+
+        code_cache.insert(expr, new PyObjectRef(code));
+    }
+
+    return PyEval_EvalCode(code.borrow(), globals.borrow(), locals.borrow());
+}
+
 void
 QPythonPriv::closing()
 {
@@ -669,6 +2007,9 @@ QPythonPriv::closing()
         return;
     }
 
+    // Python might still be starting up in the background
+    priv->waitForReady();
+
     ENSURE_GIL_STATE;
 
     if (priv->atexit_callback) {
@@ -679,11 +2020,136 @@ QPythonPriv::closing()
 
     priv->atexit_callback = PyObjectRef();
     priv->image_provider = PyObjectRef();
+    priv->image_providers.clear();
+}
+
+static QString
+image_cache_key(const QString &id, const QSize &requestedSize)
+{
+    return QString("%1x%2\n%3").arg(requestedSize.width())
+        .arg(requestedSize.height()).arg(id);
+}
+
+QPythonPriv::ImageCache *
+QPythonPriv::imageCache(const QString &provider)
+{
+    ImageCache *cache = image_caches.value(provider);
+    if (!cache) {
+        cache = new ImageCache;
+        image_caches.insert(provider, cache);
+    }
+
+    return cache;
+}
+
+bool
+QPythonPriv::lookupImage(const QString &provider, const QString &id, const QSize &requestedSize, QImage *image)
+{
+    QMutexLocker lock(&image_cache_mutex);
+    ImageCache *cache = image_caches.value(provider);
+    if (!cache || cache->images.maxCost() == 0) {
+        return false;
+    }
+
+    QImage *cached = cache->images.object(image_cache_key(id, requestedSize));
+    if (!cached) {
+        cache->misses++;
+        return false;
+    }
+
+    cache->hits++;
+    *image = *cached;
+    return true;
+}
+
+void
+QPythonPriv::storeImage(const QString &provider, const QString &id, const QSize &requestedSize, const QImage &image)
+{
+    if (image.isNull()) {
+        return;
+    }
+
+    QMutexLocker lock(&image_cache_mutex);
+    ImageCache *cache = image_caches.value(provider);
+    if (cache && cache->images.maxCost() > 0) {
+        cache->images.insert(image_cache_key(id, requestedSize), new QImage(image),
+                image.bytesPerLine() * image.height());
+    }
+}
+
+void
+QPythonPriv::invalidateImages(const QString &id, const QString &provider)
+{
+    QMutexLocker lock(&image_cache_mutex);
+    for (QMap<QString, ImageCache *>::iterator it = image_caches.begin(); it != image_caches.end(); ++it) {
+        if (!provider.isNull() && it.key() != provider) {
+            continue;
+        }
+
+        if (id.isNull()) {
+            (*it)->images.clear();
+            continue;
+        }
+
+        QList<QString> keys = (*it)->images.keys();
+        for (int i=0; i<keys.count(); i++) {
+            if (keys[i].section('\n', 1) == id) {
+                (*it)->images.remove(keys[i]);
+            }
+        }
+    }
+}
+
+PyObject *
+QPythonPriv::imageProvider(const QString &name)
+{
+    if (name.isEmpty()) {
+        return image_provider.borrow();
+    }
+
+    QMap<QString, PyObjectRef>::const_iterator it = image_providers.constFind(name);
+    if (it == image_providers.constEnd()) {
+        return NULL;
+    }
+
+    return it.value().borrow();
+}
+
+QSharedPointer<QPythonSvgCacheEntry>
+QPythonPriv::lookupSvg(const QByteArray &key)
+{
+    QMutexLocker lock(&svg_cache_mutex);
+    if (svg_cache.maxCost() == 0) {
+        return QSharedPointer<QPythonSvgCacheEntry>();
+    }
+
+    QSharedPointer<QPythonSvgCacheEntry> *cached = svg_cache.object(key);
+    if (!cached) {
+        svg_cache_misses++;
+        return QSharedPointer<QPythonSvgCacheEntry>();
+    }
+
+    svg_cache_hits++;
+    return *cached;
+}
+
+void
+QPythonPriv::storeSvg(const QByteArray &key, const QSharedPointer<QPythonSvgCacheEntry> &entry, int cost)
+{
+    // Entries are shared, so that evicting one doesn't affect a renderer in use
+    QMutexLocker lock(&svg_cache_mutex);
+    if (svg_cache.maxCost() > 0) {
+        svg_cache.insert(key, new QSharedPointer<QPythonSvgCacheEntry>(entry), cost);
+    }
 }
 
 QPythonPriv *
 QPythonPriv::instance()
 {
+    if (priv) {
+        priv->waitForReady();
+    }
+
     return priv;
 }
 
@@ -707,10 +2173,8 @@ QPythonPriv::importFromQRC(const char *module, const QString &filename)
         }
 
         QByteArray ba = qrc_importer_code.readAll();
-        QByteArray fn = QString("qrc:/" + filename).toUtf8();
 
-        PyObjectRef co(Py_CompileString(ba.constData(), fn.constData(),
-                Py_file_input), true);
+        PyObjectRef co(compile_qrc_source(ba, "qrc:/" + filename), true);
         if (!co) {
             QString result = QString("Cannot compile qrc importer: %1")
                 .arg(formatExc());
@@ -730,21 +2194,81 @@ QPythonPriv::importFromQRC(const char *module, const QString &filename)
     return QString();
 }
 
+PyObject *
+QPythonPriv::createAsyncioRunner(QString *errorMessage)
+{
+    const char *module = "pyotherside.asyncio_runner";
+    QString filename = "/io/thp/pyotherside/asyncio_runner.py";
+    *errorMessage = importFromQRC(module, filename);
+    if (!errorMessage->isNull()) {
+        return NULL;
+    }
+
+    PyObjectRef sys_modules(PySys_GetObject((char *)"modules"));
+    PyObjectRef asyncio_runner(PyMapping_GetItemString(sys_modules.borrow(),
+            (char *)module), true);
+    if (!asyncio_runner) {
+        *errorMessage = QString("Cannot find asyncio runner: %1").arg(formatExc());
+        return NULL;
+    }
+
+    PyObject *runner = PyObject_CallMethod(asyncio_runner.borrow(), "Runner", NULL);
+    if (!runner) {
+        *errorMessage = QString("Cannot create asyncio runner: %1").arg(formatExc());
+    }
+
+    return runner;
+}
+
+bool
+QPythonPriv::isAwaitable(PyObject *o)
+{
+    // Coroutines, asyncio futures and tasks and classes with __await__()
+    PyAsyncMethods *as_async = Py_TYPE(o)->tp_as_async;
+    return (as_async != NULL && as_async->am_await != NULL);
+}
+
+// Callers passing in a Python object (null name) don't need to pay for
+// repr() unless we actually have to produce an error message
+static QString
+callable_name(PyObject *callable, const QString &name)
+{
+    if (!name.isNull()) {
+        return name;
+    }
+
+    PyObjectRef repr(PyObject_Repr(callable), true);
+    return convertPyObjectToQVariant(repr.borrow()).toString();
+}
+
 QString
 QPythonPriv::call(PyObject *callable, QString name, QVariant args, QVariant *v)
 {
     if (!PyCallable_Check(callable)) {
-        return QString("Not a callable: %1").arg(name);
+        return QString("Not a callable: %1").arg(callable_name(callable, name));
     }
 
-    PyObjectRef argl(convertQVariantToPyObject(args), true);
-    if (!PyList_Check(argl.borrow())) {
+    if (args.userType() != QMetaType::QVariantList &&
+            args.userType() != QMetaType::QStringList) {
         return QString("Not a parameter list in call to %1: %2")
-                .arg(name).arg(args.toString());
+                .arg(callable_name(callable, name)).arg(args.toString());
     }
 
-    PyObjectRef argt(PyList_AsTuple(argl.borrow()), true);
-    PyObjectRef o(PyObject_Call(callable, argt.borrow(), NULL), true);
+    // Convert the arguments straight into a vectorcall argument array, the
+    // first slot is reserved so that callees can use it for "self"
+    QVariantList argl = args.toList();
+    QVarLengthArray<PyObject *, 8> argv(argl.size() + 1);
+    argv[0] = NULL;
+    for (int i=0; i<argl.size(); i++) {
+        argv[i + 1] = convertQVariantToPyObject(argl[i]);
+    }
+
+    PyObjectRef o(PyObject_Vectorcall(callable, argv.data() + 1,
+                argl.size() | PY_VECTORCALL_ARGUMENTS_OFFSET, NULL), true);
+
+    for (int i=0; i<argl.size(); i++) {
+        Py_XDECREF(argv[i + 1]);
+    }
 
     if (!o) {
         return QString("Return value of PyObject call is NULL: %1").arg(priv->formatExc());
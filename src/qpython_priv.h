@@ -27,40 +27,140 @@
 #include <QObject>
 #include <QVariant>
 #include <QString>
+#include <QStringList>
+#include <QCache>
+#include <QMap>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QImage>
+#include <QSize>
+#include <QSharedPointer>
 
 enum PyOtherSideImageFormat {
     PYOTHERSIDE_IMAGE_FORMAT_ENCODED = -1,
     PYOTHERSIDE_IMAGE_FORMAT_SVG = -2,
 };
 
+// Parsed SVG document cached by the image provider (which links to QtSvg)
+class QPythonSvgCacheEntry {
+    public:
+        virtual ~QPythonSvgCacheEntry() {}
+};
+
 class QPythonPriv : public QObject {
     Q_OBJECT
 
     public:
-        QPythonPriv();
         ~QPythonPriv();
 
+        /**
+         * Create the interpreter singleton and initialize Python on the
+         * calling thread, which becomes Python's main thread (should be
+         * the GUI thread). The modules needed at startup are imported on a
+         * separate thread (background=true) or right away. Does nothing if
+         * already started.
+         **/
+        static QPythonPriv *start(bool background);
+        // Put path in front of sys.path (also with PYOTHERSIDE_ISOLATED and
+        // PYOTHERSIDE_PYTHONPATH); a zip archive in Qt Resources (":/...",
+        // e.g. the embedded standard library) is imported from directly,
+        // without a sys.path entry; has to be called before start()
+        static void addModuleSearchPath(const QString &path);
+        bool isReady() const;
+        void waitForReady();
+
         PyObject *eval(QString expr);
+        PyObject *evalCached(QString expr);
 
         QString importFromQRC(const char *module, const QString &filename);
+        PyObject *createAsyncioRunner(QString *errorMessage);
+        static bool isAwaitable(PyObject *o);
+        // Buffered reader for a file in Qt Resources (path with ":" prefix)
+        // that reads from the resource data without copying it up front;
+        // usable before the pyotherside module is imported; requires the GIL
+        static PyObject *openResource(const QString &path);
         QString call(PyObject *callable, QString name, QVariant args, QVariant *v);
 
         void receiveObject(PyObject *o);
         static void closing();
+        // Blocks until Python is initialized, NULL if never started
         static QPythonPriv *instance();
 
         QString formatExc();
 
+        // Caches for images from the image providers, one per provider name
+        // (empty for the default provider), keyed by id and requested size;
+        // must not be called with the GIL held (evicted images might release
+        // their Python pixel data)
+        bool lookupImage(const QString &provider, const QString &id, const QSize &requestedSize, QImage *image);
+        void storeImage(const QString &provider, const QString &id, const QSize &requestedSize, const QImage &image);
+        // Null id: all images; null provider: all providers
+        void invalidateImages(const QString &id=QString(), const QString &provider=QString());
+
+        // Image provider callable for the given name (empty for the default
+        // provider), borrowed reference or NULL; requires the GIL
+        PyObject *imageProvider(const QString &name);
+
+        // Cache for parsed SVG documents, keyed by a hash of the SVG data
+        QSharedPointer<QPythonSvgCacheEntry> lookupSvg(const QByteArray &key);
+        void storeSvg(const QByteArray &key, const QSharedPointer<QPythonSvgCacheEntry> &entry, int cost);
+
         PyObjectRef locals;
         PyObjectRef globals;
         PyObjectRef atexit_callback;
         PyObjectRef image_provider;
+        // Named image providers (image://<name>/), protected by the GIL
+        QMap<QString, PyObjectRef> image_providers;
         PyObjectRef traceback_mod;
         PyObjectRef pyotherside_mod;
         PyThreadState *thread_state;
 
+        // Compiled code objects for function names used in call()
+        QCache<QString, PyObjectRef> code_cache;
+
+        // Images of one image provider, with its own budget (disabled until
+        // set_image_cache_size() is called for it)
+        struct ImageCache {
+            ImageCache() : images(0), hits(0), misses(0) {}
+            QCache<QString, QImage> images;
+            int hits;
+            int misses;
+        };
+
+        QMutex image_cache_mutex;
+        QMap<QString, ImageCache *> image_caches;
+        // Created on first use, requires image_cache_mutex
+        ImageCache *imageCache(const QString &provider);
+
+        QMutex svg_cache_mutex;
+        QCache<QByteArray, QSharedPointer<QPythonSvgCacheEntry> > svg_cache;
+        int svg_cache_hits;
+        int svg_cache_misses;
+
     signals:
         void receive(QVariant data);
+        void ready();
+        // A named image provider has been set from Python
+        void imageProviderChanged(QString name, int maxConcurrency);
+
+    private:
+        QPythonPriv();
+        void initialize();
+        void installQrcZipImporter(const QStringList &archives);
+        void importModules();
+
+        friend class QPythonPrivInitThread;
+
+        enum InitState {
+            NotStarted,
+            Initializing,
+            Ready,
+        };
+
+        QAtomicInt init_state;
+        QMutex init_mutex;
+        QWaitCondition init_condition;
 };
 
 #endif /* PYOTHERSIDE_QPYTHON_PRIV_H */
@@ -0,0 +1,405 @@
+/**
+ * PyOtherSide: Asynchronous Python 3 Bindings for Qt 5 and Qt 6
+ * Copyright (c) 2011, 2013-2025, Thomas Perl <m@thp.io>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ **/
+
+#include "qpython_texturefactory.h"
+
+#include <QQuickWindow>
+
+#ifdef PYOTHERSIDE_TEXTURE_UPLOAD_GL
+#include <QOpenGLFunctions>
+#include <QMutex>
+#include <QMutexLocker>
+#endif
+
+static QAtomicInt stat_uploads;
+static QAtomicInt stat_strided;
+static QAtomicInt stat_row_by_row;
+static QAtomicInt stat_pool_hits;
+static QAtomicInt stat_pool_misses;
+static QAtomicInt stat_fallbacks;
+
+
+QPythonTextureFactory::QPythonTextureFactory(const QImage &image)
+    : QQuickTextureFactory()
+    , m_image(image)
+{
+}
+
+QPythonTextureFactory::~QPythonTextureFactory()
+{
+}
+
+QSGTexture *
+QPythonTextureFactory::createTexture(QQuickWindow *window) const
+{
+#ifdef PYOTHERSIDE_TEXTURE_UPLOAD_GL
+    // Called on the render thread, with the scene graph's context current
+    // (there is none with the software backend)
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    GLenum format, type;
+    bool alpha;
+    if (context && QPythonTexture::glFormat(context, m_image.format(), &format, &type, &alpha)) {
+        return new QPythonTexture(m_image, format, type, alpha);
+    }
+#endif
+
+    // Unlike QQuickTextureFactory::textureFactoryForImage(), this doesn't
+    // convert the image up front; the backend converts it only if needed,
+    // but still keeps its own copy of the pixels for the upload
+    stat_fallbacks.ref();
+    return window->createTextureFromImage(m_image);
+}
+
+QSize
+QPythonTextureFactory::textureSize() const
+{
+    return m_image.size();
+}
+
+int
+QPythonTextureFactory::textureByteCount() const
+{
+    return m_image.bytesPerLine() * m_image.height();
+}
+
+QImage
+QPythonTextureFactory::image() const
+{
+    return m_image;
+}
+
+QPythonTextureStats
+QPythonTextureFactory::stats()
+{
+    QPythonTextureStats result;
+    result.uploads = stat_uploads.loadAcquire();
+    result.strided = stat_strided.loadAcquire();
+    result.rowByRow = stat_row_by_row.loadAcquire();
+    result.poolHits = stat_pool_hits.loadAcquire();
+    result.poolMisses = stat_pool_misses.loadAcquire();
+    result.fallbacks = stat_fallbacks.loadAcquire();
+    return result;
+}
+
+void
+QPythonTextureFactory::resetStats()
+{
+    stat_uploads.storeRelease(0);
+    stat_strided.storeRelease(0);
+    stat_row_by_row.storeRelease(0);
+    stat_pool_hits.storeRelease(0);
+    stat_pool_misses.storeRelease(0);
+    stat_fallbacks.storeRelease(0);
+}
+
+
+#ifdef PYOTHERSIDE_TEXTURE_UPLOAD_GL
+
+#ifndef GL_BGRA
+#define GL_BGRA 0x80E1
+#endif
+
+#ifndef GL_UNPACK_ROW_LENGTH
+#define GL_UNPACK_ROW_LENGTH 0x0CF2
+#endif
+
+// Don't keep more than this many unused textures per size and format
+static const int MAX_POOLED_TEXTURES = 4;
+
+static QMutex pools_mutex;
+static QHash<QOpenGLContext *, QPythonTexturePool *> pools;
+
+static quint64
+pool_key(const QSize &size, GLenum format)
+{
+    return ((quint64)format << 40) | ((quint64)size.width() << 20) | (quint64)size.height();
+}
+
+QPythonTexturePool::QPythonTexturePool(QOpenGLContext *context)
+    : QObject()
+    , m_context(context)
+    , m_textures()
+{
+    QObject::connect(context, SIGNAL(aboutToBeDestroyed()),
+            this, SLOT(contextDestroyed()), Qt::DirectConnection);
+}
+
+QPythonTexturePool *
+QPythonTexturePool::forContext(QOpenGLContext *context)
+{
+    // Each window might have its own render thread
+    QMutexLocker lock(&pools_mutex);
+
+    QPythonTexturePool *pool = pools.value(context);
+    if (!pool) {
+        pool = new QPythonTexturePool(context);
+        pools[context] = pool;
+    }
+
+    return pool;
+}
+
+GLuint
+QPythonTexturePool::take(const QSize &size, GLenum format, bool *fresh)
+{
+    deleteDiscarded();
+
+    QList<GLuint> &textures = m_textures[pool_key(size, format)];
+    if (!textures.isEmpty()) {
+        stat_pool_hits.ref();
+        *fresh = false;
+        return textures.takeLast();
+    }
+
+    stat_pool_misses.ref();
+    GLuint id = 0;
+    m_context->functions()->glGenTextures(1, &id);
+    *fresh = true;
+    return id;
+}
+
+void
+QPythonTexturePool::give(const QSize &size, GLenum format, GLuint id)
+{
+    QList<GLuint> &textures = m_textures[pool_key(size, format)];
+    if (textures.count() < MAX_POOLED_TEXTURES) {
+        textures.append(id);
+    } else {
+        m_context->functions()->glDeleteTextures(1, &id);
+    }
+}
+
+void
+QPythonTexturePool::discard(QOpenGLContext *context, GLuint id)
+{
+    QMutexLocker lock(&pools_mutex);
+
+    // Without a pool, the context is gone and has taken the texture with it
+    QPythonTexturePool *pool = pools.value(context);
+    if (pool) {
+        pool->m_discarded.append(id);
+    }
+}
+
+void
+QPythonTexturePool::deleteDiscarded()
+{
+    QList<GLuint> discarded;
+    {
+        QMutexLocker lock(&pools_mutex);
+        discarded.swap(m_discarded);
+    }
+
+    for (int i=0; i<discarded.count(); i++) {
+        m_context->functions()->glDeleteTextures(1, &discarded[i]);
+    }
+}
+
+void
+QPythonTexturePool::contextDestroyed()
+{
+    // The context is still current while aboutToBeDestroyed() is emitted
+    deleteDiscarded();
+    QOpenGLFunctions *gl = m_context->functions();
+    QHash<quint64, QList<GLuint> >::iterator it;
+    for (it=m_textures.begin(); it != m_textures.end(); ++it) {
+        for (int i=0; i<it.value().count(); i++) {
+            gl->glDeleteTextures(1, &it.value()[i]);
+        }
+    }
+    m_textures.clear();
+
+    {
+        QMutexLocker lock(&pools_mutex);
+        pools.remove(m_context);
+    }
+
+    deleteLater();
+}
+
+
+QPythonTexture::QPythonTexture(const QImage &image, GLenum format, GLenum type, bool alpha)
+    : QSGTexture()
+    , m_image(image)
+    , m_id(0)
+    , m_context(NULL)
+    , m_size(image.size())
+    , m_format(format)
+    , m_type(type)
+    , m_alpha(alpha)
+{
+}
+
+QPythonTexture::~QPythonTexture()
+{
+    if (!m_id) {
+        return;
+    }
+
+    if (QOpenGLContext::currentContext() == m_context) {
+        QPythonTexturePool::forContext(m_context)->give(m_size, m_format, m_id);
+    } else {
+        QPythonTexturePool::discard(m_context, m_id);
+    }
+}
+
+bool
+QPythonTexture::glFormat(QOpenGLContext *context, QImage::Format format,
+        GLenum *glFormat, GLenum *glType, bool *alpha)
+{
+    // The scene graph expects premultiplied alpha, so only premultiplied
+    // and opaque formats can be used without converting them
+    switch (format) {
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    case QImage::Format_ARGB32_Premultiplied:
+    case QImage::Format_RGB32:
+        // 0xAARRGGBB is stored as B, G, R, A in memory
+        if (context->isOpenGLES() && !context->hasExtension("GL_EXT_texture_format_BGRA8888")) {
+            return false;
+        }
+        *glFormat = GL_BGRA;
+        *glType = GL_UNSIGNED_BYTE;
+        *alpha = (format == QImage::Format_ARGB32_Premultiplied);
+        return true;
+#endif
+#if QT_VERSION >= QT_VERSION_CHECK(5, 2, 0)
+    case QImage::Format_RGBA8888_Premultiplied:
+    case QImage::Format_RGBX8888:
+        *glFormat = GL_RGBA;
+        *glType = GL_UNSIGNED_BYTE;
+        *alpha = (format == QImage::Format_RGBA8888_Premultiplied);
+        return true;
+#endif
+    case QImage::Format_RGB888:
+        *glFormat = GL_RGB;
+        *glType = GL_UNSIGNED_BYTE;
+        *alpha = false;
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool
+QPythonTexture::upload() const
+{
+    m_context = QOpenGLContext::currentContext();
+    if (!m_context) {
+        return false;
+    }
+
+    QOpenGLFunctions *gl = m_context->functions();
+
+    bool fresh = false;
+    m_id = QPythonTexturePool::forContext(m_context)->take(m_size, m_format, &fresh);
+    gl->glBindTexture(GL_TEXTURE_2D, m_id);
+
+    if (fresh) {
+        // Desktop OpenGL wants a generic internal format for BGRA data
+        GLenum internalFormat = m_format;
+        if (m_format == GL_BGRA && !m_context->isOpenGLES()) {
+            internalFormat = GL_RGBA;
+        }
+        gl->glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, m_size.width(), m_size.height(),
+                0, m_format, m_type, NULL);
+    }
+
+    int bytesPerPixel = m_image.depth() / 8;
+    int bytesPerLine = m_image.bytesPerLine();
+    int rowLength = m_size.width() * bytesPerPixel;
+
+    int alignment = 1;
+    while (alignment < 8 && bytesPerLine % (alignment * 2) == 0 &&
+            ((quintptr)m_image.constBits()) % (alignment * 2) == 0) {
+        alignment *= 2;
+    }
+    gl->glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+
+    bool hasRowLength = !m_context->isOpenGLES() || m_context->format().majorVersion() >= 3;
+
+    if (bytesPerLine == (rowLength + alignment - 1) / alignment * alignment) {
+        // Rows are laid out the way OpenGL expects them
+        gl->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_size.width(), m_size.height(),
+                m_format, m_type, m_image.constBits());
+    } else if (hasRowLength && bytesPerLine % bytesPerPixel == 0) {
+        // Padded rows (explicit stride)
+        stat_strided.ref();
+        gl->glPixelStorei(GL_UNPACK_ROW_LENGTH, bytesPerLine / bytesPerPixel);
+        gl->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_size.width(), m_size.height(),
+                m_format, m_type, m_image.constBits());
+        gl->glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    } else {
+        // OpenGL ES 2 can't skip padding, upload row by row instead of copying
+        stat_row_by_row.ref();
+        for (int y=0; y<m_size.height(); y++) {
+            gl->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, m_size.width(), 1,
+                    m_format, m_type, m_image.constScanLine(y));
+        }
+    }
+
+    gl->glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    stat_uploads.ref();
+
+    // The texture has its own copy now; the factory still holds the image
+    m_image = QImage();
+    return true;
+}
+
+int
+QPythonTexture::textureId() const
+{
+    if (!m_id) {
+        upload();
+    }
+
+    return m_id;
+}
+
+QSize
+QPythonTexture::textureSize() const
+{
+    return m_size;
+}
+
+bool
+QPythonTexture::hasAlphaChannel() const
+{
+    return m_alpha;
+}
+
+bool
+QPythonTexture::hasMipmaps() const
+{
+    return false;
+}
+
+void
+QPythonTexture::bind()
+{
+    bool first = (m_id == 0);
+    if (first) {
+        if (!upload()) {
+            return;
+        }
+    } else {
+        QOpenGLContext::currentContext()->functions()->glBindTexture(GL_TEXTURE_2D, m_id);
+    }
+
+    updateBindOptions(first);
+}
+
+#endif /* PYOTHERSIDE_TEXTURE_UPLOAD_GL */
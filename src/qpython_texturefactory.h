@@ -0,0 +1,130 @@
+/**
+ * PyOtherSide: Asynchronous Python 3 Bindings for Qt 5 and Qt 6
+ * Copyright (c) 2011, 2013-2025, Thomas Perl <m@thp.io>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ **/
+
+#ifndef PYOTHERSIDE_QPYTHON_TEXTUREFACTORY_H
+#define PYOTHERSIDE_QPYTHON_TEXTUREFACTORY_H
+
+#include <QImage>
+#include <QSize>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QAtomicInt>
+#include <QQuickImageProvider>
+
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0) && !defined(QT_NO_OPENGL)
+#define PYOTHERSIDE_TEXTURE_UPLOAD_GL
+#include <QOpenGLContext>
+#include <QSGTexture>
+#endif
+
+// Number of textures created each way since the last reset (for
+// benchmarks/texture.cpp); the GL counters stay 0 with Qt 6
+struct QPythonTextureStats {
+    int uploads;     // uploaded straight from the image data
+    int strided;     // ... of which with GL_UNPACK_ROW_LENGTH (padded rows)
+    int rowByRow;    // ... of which row by row (padded rows on OpenGL ES 2)
+    int poolHits;    // texture storage reused from QPythonTexturePool
+    int poolMisses;  // texture storage allocated
+    int fallbacks;   // QQuickWindow::createTextureFromImage() (copies)
+};
+
+// Creates textures from image provider results without converting them
+// first: the image (usually wrapping the Python buffer) is uploaded as-is
+// if the scene graph can use its format directly, otherwise Qt converts it.
+class QPythonTextureFactory : public QQuickTextureFactory {
+public:
+    QPythonTextureFactory(const QImage &image);
+    virtual ~QPythonTextureFactory();
+
+    virtual QSGTexture *createTexture(QQuickWindow *window) const;
+    virtual QSize textureSize() const;
+    virtual int textureByteCount() const;
+    virtual QImage image() const;
+
+    static QPythonTextureStats stats();
+    static void resetStats();
+
+private:
+    QImage m_image;
+};
+
+#ifdef PYOTHERSIDE_TEXTURE_UPLOAD_GL
+
+// OpenGL textures of released frames for one context, reused for frames
+// with the same size and format (e.g. video or live charts)
+class QPythonTexturePool : public QObject {
+    Q_OBJECT
+
+public:
+    // Requires the context to be current
+    static QPythonTexturePool *forContext(QOpenGLContext *context);
+
+    // *fresh is set if the texture storage needs to be allocated
+    GLuint take(const QSize &size, GLenum format, bool *fresh);
+    void give(const QSize &size, GLenum format, GLuint id);
+
+    // For textures released while their context is not current (any thread);
+    // they are deleted the next time the pool is used on that context
+    static void discard(QOpenGLContext *context, GLuint id);
+
+private slots:
+    void contextDestroyed();
+
+private:
+    QPythonTexturePool(QOpenGLContext *context);
+
+    void deleteDiscarded();
+
+    QOpenGLContext *m_context;
+    QHash<quint64, QList<GLuint> > m_textures;
+    // Protected by the mutex for the list of pools
+    QList<GLuint> m_discarded;
+};
+
+// Texture uploaded with glTexSubImage2D() straight from the image data,
+// honoring its stride; must be created and used on the render thread
+class QPythonTexture : public QSGTexture {
+public:
+    QPythonTexture(const QImage &image, GLenum format, GLenum type, bool alpha);
+    virtual ~QPythonTexture();
+
+    // Format and type for uploading images in this format directly, if possible
+    static bool glFormat(QOpenGLContext *context, QImage::Format format,
+            GLenum *glFormat, GLenum *glType, bool *alpha);
+
+    virtual int textureId() const;
+    virtual QSize textureSize() const;
+    virtual bool hasAlphaChannel() const;
+    virtual bool hasMipmaps() const;
+    virtual void bind();
+
+private:
+    bool upload() const;
+
+    mutable QImage m_image;
+    mutable GLuint m_id;
+    mutable QOpenGLContext *m_context;
+    QSize m_size;
+    GLenum m_format;
+    GLenum m_type;
+    bool m_alpha;
+};
+
+#endif /* PYOTHERSIDE_TEXTURE_UPLOAD_GL */
+
+#endif /* PYOTHERSIDE_QPYTHON_TEXTUREFACTORY_H */
@@ -16,30 +16,610 @@
  * PERFORMANCE OF THIS SOFTWARE.
  **/
 
+#include "qml_python_bridge.h"
+
 #include "qpython.h"
+#include "qpython_priv.h"
 
 #include "qpython_worker.h"
 
+#include "ensure_gil_state.h"
+
+#include <QMutex>
+
 
 QPythonWorker::QPythonWorker(QPython *qpython)
     : QObject()
+    , qpython_mutex()
     , qpython(qpython)
+    , abandon_mutex()
+    , in_call(false)
+    , abandoned(false)
+    , asyncio_runner()
+    , asyncio_watcher(new QPythonAsyncioWatcher(this))
+    , awaiting()
+    , next_token(0)
 {
+    QObject::connect(asyncio_watcher, SIGNAL(activated()),
+                     this, SLOT(step_awaitables()));
 }
 
 QPythonWorker::~QPythonWorker()
 {
+    if (asyncio_runner) {
+        ENSURE_GIL_STATE;
+
+        // Cancel awaitables that are still running
+        PyObjectRef result(PyObject_CallMethod(asyncio_runner.borrow(), "close", NULL), true);
+        if (!result) {
+            PyErr_Print();
+        }
+        asyncio_runner = PyObjectRef();
+    }
+
+    for (QMap<int,Awaiting>::const_iterator it = awaiting.begin(); it != awaiting.end(); ++it) {
+        delete it->callback;
+    }
+}
+
+struct SharedThread {
+    QThread *thread;
+    int users;
+};
+
+static QMutex shared_threads_mutex;
+static QList<SharedThread> shared_threads;
+// Blocked in a call, deleted once their last user is gone
+static QList<SharedThread> retired_threads;
+
+static int
+sharedThreadCount()
+{
+    bool ok = false;
+    int count = qgetenv("PYOTHERSIDE_WORKER_THREADS").toInt(&ok);
+    if (!ok || count < 1) {
+        count = 2;
+    }
+    return count;
+}
+
+QThread *
+QPythonWorker::acquireSharedThread()
+{
+    QMutexLocker locker(&shared_threads_mutex);
+
+    if (shared_threads.count() < sharedThreadCount()) {
+        SharedThread shared = { new QThread, 0 };
+        shared.thread->setObjectName(QString("QPythonWorker-shared-%1").arg(shared_threads.count()));
+        shared.thread->start();
+        shared_threads.append(shared);
+    }
+
+    // Least used thread, so that busy Python objects are spread out
+    int best = 0;
+    for (int i=1; i<shared_threads.count(); i++) {
+        if (shared_threads[i].users < shared_threads[best].users) {
+            best = i;
+        }
+    }
+
+    shared_threads[best].users++;
+    return shared_threads[best].thread;
 }
 
 void
-QPythonWorker::process(QVariant func, QVariant unboxed_args, QJSValue *callback)
+QPythonWorker::releaseSharedThread(QThread *thread)
 {
-    QVariant result = qpython->call_internal(func, unboxed_args, false);
-    if (callback) {
-        emit finished(result, callback);
+    QMutexLocker locker(&shared_threads_mutex);
+
+    for (int i=0; i<shared_threads.count(); i++) {
+        if (shared_threads[i].thread == thread) {
+            if (--shared_threads[i].users == 0) {
+                thread->quit();
+                thread->wait();
+                delete thread;
+                shared_threads.removeAt(i);
+            }
+            return;
+        }
+    }
+
+    for (int i=0; i<retired_threads.count(); i++) {
+        if (retired_threads[i].thread == thread) {
+            if (--retired_threads[i].users == 0) {
+                // Might still be blocked, so don't wait for it
+                QObject::connect(thread, SIGNAL(finished()),
+                                 thread, SLOT(deleteLater()));
+                thread->quit();
+                retired_threads.removeAt(i);
+            }
+            return;
+        }
+    }
+}
+
+void
+QPythonWorker::retireSharedThread(QThread *thread)
+{
+    {
+        QMutexLocker locker(&shared_threads_mutex);
+
+        for (int i=0; i<shared_threads.count(); i++) {
+            if (shared_threads[i].thread == thread) {
+                retired_threads.append(shared_threads.takeAt(i));
+                break;
+            }
+        }
+    }
+
+    releaseSharedThread(thread);
+}
+
+void
+QPythonWorker::detach()
+{
+    // Called from ~QPython in the QML thread: only waits for the request that
+    // is running right now (not for other Python objects sharing the thread);
+    // the worker drops everything else once it sees that qpython is gone
+    QList<QJSValue *> callbacks;
+    {
+        QMutexLocker locker(QThread::currentThread() == thread() ? NULL : &qpython_mutex);
+        qpython = NULL;
+
+        // QJSValues must be deleted in the QML thread
+        for (QMap<int,Awaiting>::iterator it = awaiting.begin(); it != awaiting.end(); ++it) {
+            callbacks << it->callback;
+            it->callback = NULL;
+        }
+    }
+
+    qDeleteAll(callbacks);
+}
+
+bool
+QPythonWorker::abandon(QList<QPythonRequest> *dropped)
+{
+    QMutexLocker locker(&abandon_mutex);
+    if (!in_call) {
+        return false;
+    }
+
+    abandoned = true;
+
+    // The worker thread doesn't touch these anymore once it sees that it
+    // was abandoned, and QJSValues must be deleted in the QML thread
+    for (QMap<int,Awaiting>::iterator it = awaiting.begin(); it != awaiting.end(); ++it) {
+        if (!it->timed_out) {
+            QPythonRequest request = { it->promise ? QPythonRequest::CallPromise : QPythonRequest::Call,
+                it->id, QVariant(), QVariant(), it->callback, QString() };
+            dropped->append(request);
+        }
+        it->callback = NULL;
+    }
+
+    QList<BlockedCall> calls = retry_calls + blocked_calls;
+    for (int i=0; i<calls.count(); i++) {
+        QPythonRequest request = { QPythonRequest::CallPromise, calls[i].id,
+            calls[i].func, calls[i].args, NULL, QString() };
+        dropped->append(request);
+    }
+    retry_calls.clear();
+    blocked_calls.clear();
+
+    return true;
+}
+
+bool
+QPythonWorker::call(const QVariant &func, const QVariant &args, QVariant *result,
+        QString *errorMessage)
+{
+    // Called with the GIL held, instead of QPython::call_internal(), so that
+    // nothing of the Python object is used anymore if it was abandoned
+    QString name;
+    PyObjectRef callable = qpython->lookupCallable(func, &name, errorMessage);
+    if (!callable) {
+        return true;
+    }
+
+    {
+        QMutexLocker locker(&abandon_mutex);
+        in_call = true;
+    }
+
+    QString callError = QPythonPriv::instance()->call(callable.borrow(), name, args, result);
+
+    {
+        QMutexLocker locker(&abandon_mutex);
+        in_call = false;
+        if (abandoned) {
+            // The Python object continued on a new worker, and might be gone
+            qpython = NULL;
+        }
+    }
+
+    if (!qpython) {
+        PyThreadState_SetAsyncExc(PyThread_get_thread_ident(), NULL);
+        *result = QVariant();
+        return false;
+    }
+
+    if (!callError.isNull()) {
+        if (!errorMessage->isEmpty()) {
+            errorMessage->append('\n');
+        }
+        errorMessage->append(callError);
+    }
+
+    return true;
+}
+
+void
+QPythonWorker::drain()
+{
+    // Requests issued while Python is still starting up stay queued
+    QPython::priv->waitForReady();
+
+    QMutexLocker locker(&qpython_mutex);
+    if (!qpython) {
+        // Detached, the remaining requests were dropped with the queue
+        return;
+    }
+
+    QPythonRequest request;
+    if (!qpython->dequeueRequest(&request)) {
+        return;
+    }
+
+    switch (request.type) {
+        case QPythonRequest::Call:
+            process(request.func, request.args, request.callback, request.id);
+            break;
+        case QPythonRequest::CallPromise:
+            process_promise(request.id, request.func, request.args);
+            break;
+        case QPythonRequest::Import:
+            if (request.args.isValid()) {
+                import_names(request.func.toString(), request.args, request.callback);
+            } else {
+                import(request.func.toString(), request.callback);
+            }
+            break;
+        case QPythonRequest::ImportPromise:
+            import_promise(request.id, request.func.toString(), request.args);
+            break;
+        case QPythonRequest::Release:
+            release_promise(request.id);
+            break;
+    }
+
+    if (!qpython) {
+        // Abandoned while the request was running
+        return;
+    }
+
+    // One request per event loop iteration, so that awaitables keep running,
+    // and Python objects sharing the thread take turns
+    QMetaObject::invokeMethod(this, "drain", Qt::QueuedConnection);
+}
+
+void
+QPythonWorker::process(QVariant func, QVariant unboxed_args, QJSValue *callback, int id)
+{
+    QString errorMessage;
+    QVariant result;
+    bool awaitable;
+    bool timed_out;
+    {
+        // The thread state has to exist from beginRequest() to endRequest(),
+        // so that a deadline expiring in between (even before the call got
+        // the GIL) can raise TimeoutError in it
+        ENSURE_GIL_STATE;
+
+        if (!qpython->beginRequest(id)) {
+            // Timed out while queued, error has already been reported
+            if (callback || id) {
+                emit finished(QVariant(), callback, id, false);
+            }
+            return;
+        }
+
+        if (!call(func, unboxed_args, &result, &errorMessage)) {
+            // Abandoned, see QPython::abandonWorker()
+            return;
+        }
+        awaitable = qpython->sinceApiVersion(1, 6) && is_awaitable(result);
+        timed_out = qpython->endRequest(id, awaitable);
+    }
+
+    bool ok = true;
+    if (timed_out) {
+        // Timed out, error has already been reported
+        result = QVariant();
+        ok = false;
+    } else if (!errorMessage.isNull()) {
+        qpython->emitError(errorMessage);
+        ok = false;
+    }
+
+    if (awaitable && schedule_awaitable(result, callback, id, false)) {
+        // Callback will be called once the awaitable is done
+        return;
+    }
+
+    if (callback || id) {
+        emit finished(result, callback, id, ok);
     }
 }
 
+void
+QPythonWorker::process_promise(int id, QVariant func, QVariant unboxed_args)
+{
+    if (waits_for_awaitable(func, unboxed_args)) {
+        // Run once the awaitable of the pipelined request is done
+        BlockedCall call = { id, func, unboxed_args };
+        blocked_calls.append(call);
+        return;
+    }
+
+    QString errorMessage;
+    QVariantList args = unboxed_args.toList();
+    bool ok = resolve_promise_ref(func, &errorMessage);
+    for (int i=0; ok && i<args.count(); i++) {
+        ok = resolve_promise_ref(args[i], &errorMessage);
+    }
+
+    if (!ok) {
+        settle(id, false, errorMessage);
+        return;
+    }
+
+    QVariant result;
+    bool awaitable = false;
+    bool timed_out;
+    {
+        // See process()
+        ENSURE_GIL_STATE;
+
+        if (!qpython->beginRequest(id)) {
+            timed_out = true;
+        } else {
+            if (!call(func, args, &result, &errorMessage)) {
+                return;
+            }
+            awaitable = qpython->sinceApiVersion(1, 6) && is_awaitable(result);
+            timed_out = qpython->endRequest(id, awaitable);
+        }
+    }
+
+    if (timed_out) {
+        settle(id, false, QString("Call to '%1' timed out").arg(func.toString()));
+    } else if (!errorMessage.isNull()) {
+        settle(id, false, errorMessage);
+    } else if (awaitable && schedule_awaitable(result, NULL, id, true)) {
+        pending_promises.insert(id);
+    } else {
+        settle(id, true, result);
+    }
+}
+
+void
+QPythonWorker::import_promise(int id, QString name, QVariant args)
+{
+    QString errorMessage;
+    bool result;
+    if (args.isValid()) {
+        result = qpython->importNames_internal(name, args, &errorMessage);
+    } else {
+        result = qpython->importModule_internal(name, &errorMessage);
+    }
+
+    if (!errorMessage.isNull()) {
+        settle(id, false, errorMessage);
+    } else {
+        settle(id, result, result);
+    }
+}
+
+void
+QPythonWorker::release_promise(int id)
+{
+    promise_results.remove(id);
+}
+
+void
+QPythonWorker::settle(int id, bool ok, QVariant value)
+{
+    PromiseResult result = { ok, value };
+    promise_results.insert(id, result);
+    emit settled(id, ok, value);
+
+    if (pending_promises.remove(id)) {
+        // Retry calls that were waiting for this result; the ones that are
+        // still blocked go back to blocked_calls
+        retry_calls.append(blocked_calls);
+        blocked_calls.clear();
+        while (qpython && !retry_calls.isEmpty()) {
+            BlockedCall blocked = retry_calls.takeFirst();
+            process_promise(blocked.id, blocked.func, blocked.args);
+        }
+    }
+}
+
+bool
+QPythonWorker::waits_for_awaitable(const QVariant &func, const QVariant &args)
+{
+    QVariantList values = args.toList();
+    values.prepend(func);
+    for (int i=0; i<values.count(); i++) {
+        const QVariant &v = values[i];
+        if (v.userType() == qMetaTypeId<QPythonPromiseRef>() &&
+                pending_promises.contains(v.value<QPythonPromiseRef>().id)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool
+QPythonWorker::resolve_promise_ref(QVariant &v, QString *errorMessage)
+{
+    if (v.userType() != qMetaTypeId<QPythonPromiseRef>()) {
+        return true;
+    }
+
+    int id = v.value<QPythonPromiseRef>().id;
+    if (!promise_results.contains(id)) {
+        *errorMessage = QString("Result of pipelined request %1 is not available").arg(id);
+        return false;
+    }
+
+    const PromiseResult &result = promise_results[id];
+    if (!result.ok) {
+        *errorMessage = QString("Pipelined request failed: %1").arg(result.value.toString());
+        return false;
+    }
+
+    v = result.value;
+    return true;
+}
+
+bool
+QPythonWorker::is_awaitable(const QVariant &result)
+{
+    if (result.userType() != qMetaTypeId<PyObjectRef>()) {
+        return false;
+    }
+
+    ENSURE_GIL_STATE;
+    return QPythonPriv::isAwaitable(result.value<PyObjectRef>().borrow());
+}
+
+bool
+QPythonWorker::schedule_awaitable(QVariant result, QJSValue *callback, int id, bool promise)
+{
+    if (result.userType() != qMetaTypeId<PyObjectRef>()) {
+        return false;
+    }
+
+    ENSURE_GIL_STATE;
+
+    PyObjectRef awaitable = result.value<PyObjectRef>();
+    if (!QPythonPriv::isAwaitable(awaitable.borrow())) {
+        return false;
+    }
+
+    QPythonPriv *priv = QPythonPriv::instance();
+
+    if (!asyncio_runner) {
+        QString errorMessage;
+        asyncio_runner = PyObjectRef(priv->createAsyncioRunner(&errorMessage), true);
+        if (!asyncio_runner) {
+            qpython->emitError(errorMessage);
+            return false;
+        }
+    }
+
+    int token = next_token++;
+    PyObjectRef scheduled(PyObject_CallMethod(asyncio_runner.borrow(), "schedule", "iO",
+                token, awaitable.borrow()), true);
+    if (!scheduled) {
+        qpython->emitError(QString("Cannot schedule awaitable: %1").arg(priv->formatExc()));
+        return false;
+    }
+
+    Awaiting a = { callback, id, promise, false };
+    awaiting.insert(token, a);
+    asyncio_watcher->wakeUp();
+    return true;
+}
+
+void
+QPythonWorker::step_awaitables()
+{
+    QMutexLocker locker(&qpython_mutex);
+    if (!qpython) {
+        // Detached, awaitables are cancelled when the worker is deleted
+        return;
+    }
+
+    ENSURE_GIL_STATE;
+
+    QPythonPriv *priv = QPythonPriv::instance();
+
+    PyObjectRef result(PyObject_CallMethod(asyncio_runner.borrow(), "step", NULL), true);
+
+    PyObject *done = result ? asyncio_watcher->update(result.borrow()) : NULL;
+    if (!done) {
+        qpython->emitError(QString("Cannot run asyncio event loop: %1").arg(priv->formatExc()));
+        // Try again later, so that pending awaitables are not stuck forever
+        asyncio_watcher->wakeUp(100);
+        return;
+    }
+
+    PyObjectRef iter(PyObject_GetIter(done), true);
+    PyObjectRef item;
+    while (qpython && iter && (item = PyObjectRef(PyIter_Next(iter.borrow()), true))) {
+        // qpython is NULL once abandoned in a call retried by settle()
+        int token = 0;
+        int ok = 0;
+        PyObject *value = NULL;
+        if (!PyArg_ParseTuple(item.borrow(), "ipO", &token, &ok, &value)) {
+            PyErr_Print();
+            continue;
+        }
+
+        Awaiting a = awaiting.take(token);
+        QVariant v = convertPyObjectToQVariant(value);
+        if (a.timed_out) {
+            // Already reported in the QML thread
+            ok = false;
+            v = QString("Call timed out");
+        }
+
+        if (a.promise) {
+            settle(a.id, ok, v);
+            continue;
+        }
+
+        if (a.timed_out) {
+            v = QVariant();
+        } else if (!ok) {
+            qpython->emitError(QString("Awaitable failed: %1").arg(v.toString()));
+            v = QVariant();
+        }
+
+        if (a.callback || a.id) {
+            emit finished(v, a.callback, a.id, ok);
+        }
+    }
+}
+
+void
+QPythonWorker::cancel_awaitable(int id)
+{
+    QMutexLocker locker(&qpython_mutex);
+    if (!asyncio_runner || !qpython) {
+        return;
+    }
+
+    ENSURE_GIL_STATE;
+
+    for (QMap<int,Awaiting>::iterator it = awaiting.begin(); it != awaiting.end(); ++it) {
+        if (it->id == id && !it->timed_out) {
+            it->timed_out = true;
+            PyObjectRef result(PyObject_CallMethod(asyncio_runner.borrow(), "cancel", "i",
+                        it.key()), true);
+            if (!result) {
+                PyErr_Print();
+            }
+        }
+    }
+
+    // Collect the cancelled task
+    asyncio_watcher->wakeUp();
+}
+
 void
 QPythonWorker::import(QString name, QJSValue *callback)
 {
@@ -19,12 +19,29 @@
 #ifndef PYOTHERSIDE_QPYTHON_WORKER_H
 #define PYOTHERSIDE_QPYTHON_WORKER_H
 
+#include "pyobject_ref.h"
+#include "qpython_asynciowatcher.h"
+
 #include <QObject>
 #include <QString>
 #include <QVariant>
 #include <QJSValue>
+#include <QTimer>
+#include <QMap>
+#include <QSet>
+#include <QList>
+#include <QThread>
+#include <QMutex>
 
 class QPython;
+struct QPythonRequest;
+
+// Placeholder for a pending promise passed to call_promise(), resolved
+// to the result of that promise's request in the worker thread
+struct QPythonPromiseRef {
+    int id;
+};
+Q_DECLARE_METATYPE(QPythonPromiseRef)
 
 class QPythonWorker : public QObject {
     Q_OBJECT
@@ -33,17 +50,94 @@ class QPythonWorker : public QObject {
         QPythonWorker(QPython *qpython);
         ~QPythonWorker();
 
+        // Worker threads shared by Python objects with sharedWorker set
+        static QThread *acquireSharedThread();
+        static void releaseSharedThread(QThread *thread);
+        // Stop assigning a thread that is blocked in a call, and release it
+        static void retireSharedThread(QThread *thread);
+
+        // Stop using the Python object (which is about to be deleted); the
+        // worker has to be deleted with deleteLater() afterwards
+        void detach();
+
+        // Give up on the call that is running right now (QML thread). The
+        // worker drops the result once the call returns and does nothing
+        // afterwards; requests it still had are added to dropped. False
+        // if the call has returned already
+        bool abandon(QList<QPythonRequest> *dropped);
+
     public slots:
-        void process(QVariant func, QVariant unboxed_args, QJSValue *callback);
-        void import(QString func, QJSValue *callback);
-        void import_names(QString func, QVariant args, QJSValue *callback);
+        void drain();
+        void cancel_awaitable(int id);
 
     signals:
-        void finished(QVariant result, QJSValue *callback);
+        void finished(QVariant result, QJSValue *callback, int id, bool ok);
         void imported(bool result, QJSValue *callback);
+        void settled(int id, bool ok, QVariant value);
+
+    private slots:
+        void step_awaitables();
 
     private:
+        void process(QVariant func, QVariant unboxed_args, QJSValue *callback, int id);
+        void import(QString func, QJSValue *callback);
+        void import_names(QString func, QVariant args, QJSValue *callback);
+
+        void process_promise(int id, QVariant func, QVariant unboxed_args);
+        void import_promise(int id, QString name, QVariant args);
+        void release_promise(int id);
+
+        bool call(const QVariant &func, const QVariant &args, QVariant *result,
+                QString *errorMessage);
+
+        struct Awaiting {
+            QJSValue *callback;
+            int id;
+            bool promise;
+            bool timed_out;
+        };
+
+        struct PromiseResult {
+            bool ok;
+            QVariant value;
+        };
+
+        struct BlockedCall {
+            int id;
+            QVariant func;
+            QVariant args;
+        };
+
+        static bool is_awaitable(const QVariant &result);
+        bool schedule_awaitable(QVariant result, QJSValue *callback, int id, bool promise);
+        void settle(int id, bool ok, QVariant value);
+        bool waits_for_awaitable(const QVariant &func, const QVariant &args);
+        bool resolve_promise_ref(QVariant &v, QString *errorMessage);
+
+        // NULL once detached; held while a request or awaitable is handled,
+        // taken before the GIL
+        QMutex qpython_mutex;
         QPython *qpython;
+
+        // Set while a call runs and when it was abandoned, taken after the
+        // GIL (but never together with it in the QML thread)
+        QMutex abandon_mutex;
+        bool in_call;
+        bool abandoned;
+
+        // asyncio event loop for awaitables returned from calls
+        PyObjectRef asyncio_runner;
+        QPythonAsyncioWatcher *asyncio_watcher;
+        QMap<int,Awaiting> awaiting;
+        int next_token;
+
+        // Results of promise requests, kept until the QML thread has
+        // received them, so that calls issued in the meantime can use them
+        QMap<int,PromiseResult> promise_results;
+        // Promise requests with a pending awaitable, and calls waiting for them
+        QSet<int> pending_promises;
+        QList<BlockedCall> blocked_calls;
+        QList<BlockedCall> retry_calls;
 };
 
 #endif /* PYOTHERSIDE_QPYTHON_WORKER_H */
@@ -22,19 +22,6 @@ from importlib.util import spec_from_loader
 import pyotherside
 
 
-def get_filename(fullname):
-    basename = fullname.replace(".", "/")
-
-    for import_path in sys.path:
-        if not import_path.startswith("qrc:"):
-            continue
-
-        for candidate in ("{}/{}.py", "{}/{}/__init__.py"):
-            filename = candidate.format(import_path, basename)
-            if pyotherside.qrc_is_file(filename[len("qrc:"):]):
-                return filename
-
-
 class PyOtherSideQtRCLoader(abc.SourceLoader):
     def __init__(self, filepath):
         self.filepath = filepath
@@ -43,16 +30,25 @@ class PyOtherSideQtRCLoader(abc.SourceLoader):
         return pyotherside.qrc_get_file_contents(self.filepath[len("qrc:"):])
 
     def get_filename(self, fullname):
-        return get_filename(fullname)
+        return self.filepath
+
+    def get_code(self, fullname):
+        # Compiled code is cached across application starts
+        return pyotherside.qrc_compile(self.filepath[len("qrc:"):])
 
 
 class PyOtherSideQtRCImporter(abc.MetaPathFinder):
     def find_spec(self, fullname, path, target=None):
         if path is None or all(x.startswith('qrc:') for x in path):
-            fname = get_filename(fullname)
+            # Looked up in an index of all modules in the qrc: entries of
+            # sys.path, which is maintained in C++
+            fname = pyotherside.qrc_find_module(fullname)
             if fname:
                 return spec_from_loader(fullname, PyOtherSideQtRCLoader(fname))
         return None
 
+    def invalidate_caches(self):
+        pyotherside.qrc_invalidate_index()
+
 
 sys.meta_path.append(PyOtherSideQtRCImporter())
@@ -0,0 +1,102 @@
+#
+# PyOtherSide: Asynchronous Python 3 Bindings for Qt 5 and Qt 6
+# Copyright (c) 2014, Thomas Perl <m@thp.io>
+#
+# Permission to use, copy, modify, and/or distribute this software for any
+# purpose with or without fee is hereby granted, provided that the above
+# copyright notice and this permission notice appear in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+# REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+# FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+# INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+# LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+# OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+# PERFORMANCE OF THIS SOFTWARE.
+#
+
+# Imports from zip archives in Qt Resources (such as the embedded
+# pythonlib.zip), read through pyotherside.qrc_open() without extracting
+# them. This is installed before the standard library can be imported, so
+# only builtin and frozen modules may be used here.
+
+import sys
+import zipimport
+import _frozen_importlib_external
+
+# Archive paths in Qt Resources (":/..."), set by install()
+archives = []
+qrc_open = None
+
+
+class QtRCArchiveIO:
+    # Stands in for the _io module in zipimport, which reads archives using
+    # _io.open_code(); paths of other archives are passed through
+    def __init__(self, io):
+        self.io = io
+
+    def __getattr__(self, name):
+        return getattr(self.io, name)
+
+    def open_code(self, path):
+        if path in archives:
+            return qrc_open(path[len(':'):])
+        return self.io.open_code(path)
+
+
+class PyOtherSideQtRCZipImporter(zipimport.zipimporter):
+    # Path hook for the archives and the packages in them, which zipimporter
+    # rejects as they are not files on disk
+    def __init__(self, path):
+        if not isinstance(path, str):
+            raise zipimport.ZipImportError('not a Qt Resource archive', path=path)
+
+        for archive in archives:
+            if path == archive:
+                prefix = ''
+                break
+            if path.startswith(archive) and path[len(archive)] in '/\\':
+                prefix = path[len(archive) + 1:]
+                break
+        else:
+            raise zipimport.ZipImportError('not a Qt Resource archive', path=path)
+
+        if zipimport.alt_path_sep:
+            prefix = prefix.replace(zipimport.alt_path_sep, zipimport.path_sep)
+        if prefix and not prefix.endswith(zipimport.path_sep):
+            prefix += zipimport.path_sep
+
+        files = zipimport._zip_directory_cache.get(archive)
+        if files is None:
+            files = zipimport._read_directory(archive)
+            zipimport._zip_directory_cache[archive] = files
+
+        # Python 3.12 and older look up entries in _files
+        self._files = files
+        self.archive = archive
+        self.prefix = prefix
+
+
+class PyOtherSideQtRCZipFinder:
+    # Finds top-level modules in the archives, which are not in sys.path;
+    # modules in packages are found through __path__ and the path hook
+    @classmethod
+    def find_spec(cls, fullname, path=None, target=None):
+        if path is None:
+            return _frozen_importlib_external.PathFinder.find_spec(fullname,
+                    archives, target)
+        return None
+
+    @classmethod
+    def invalidate_caches(cls):
+        pass
+
+
+def install(paths, open_func):
+    global qrc_open
+    archives.extend(paths)
+    qrc_open = open_func
+
+    zipimport._io = QtRCArchiveIO(zipimport._io)
+    sys.path_hooks.append(PyOtherSideQtRCZipImporter)
+    sys.meta_path.append(PyOtherSideQtRCZipFinder)
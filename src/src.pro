@@ -30,6 +30,8 @@ HEADERS += pyotherside_plugin.h
 # QML Image Provider
 SOURCES += qpython_imageprovider.cpp
 HEADERS += qpython_imageprovider.h
+SOURCES += qpython_texturefactory.cpp
+HEADERS += qpython_texturefactory.h
 
 # PyGLArea
 SOURCES += pyglarea.cpp pyglrenderer.cpp
@@ -39,9 +41,23 @@ HEADERS += pyglarea.h pyglrenderer.h
 SOURCES += pyfbo.cpp
 HEADERS += pyfbo.h
 
+# PyTiledImage
+SOURCES += pytiledimage.cpp
+HEADERS += pytiledimage.h
+
+# PyFrameStream
+SOURCES += pyframestream.cpp
+HEADERS += pyframestream.h
+
 # Importer from Qt Resources
 RESOURCES += qrc_importer.qrc
 
+# Importer from zip archives in Qt Resources (e.g. pythonlib.zip)
+RESOURCES += qrc_zipimporter.qrc
+
+# asyncio event loop for awaitables returned from call()
+RESOURCES += asyncio_runner.qrc
+
 # Embedded Python Library (add pythonlib.zip if you want this)
 exists (pythonlib.zip) {
     RESOURCES += pythonlib_loader.qrc
@@ -60,8 +76,14 @@ SOURCES += qpython.cpp
 HEADERS += qpython.h
 SOURCES += qpython_worker.cpp
 HEADERS += qpython_worker.h
+SOURCES += qpython_asynciowatcher.cpp
+HEADERS += qpython_asynciowatcher.h
 SOURCES += qpython_priv.cpp
 HEADERS += qpython_priv.h
+SOURCES += qpython_framestream.cpp
+HEADERS += qpython_framestream.h
+SOURCES += qpython_callable.cpp
+HEADERS += qpython_callable.h
 
 # Globally Load Python hack
 SOURCES += global_libpython_loader.cpp
@@ -20,11 +20,14 @@
 #include "qvariant_converter.h"
 
 #include "qpython.h"
+#include "qpython_callable.h"
 #include "converter.h"
 #include "qml_python_bridge.h"
 
 #include "tests.h"
 
+#include <QJSEngine>
+
 
 // "Ensure that the current thread is ready to call the Python C API regardless
 //  of the current state of Python, or of the global interpreter lock."
@@ -400,3 +403,65 @@ TestPyOtherSide::testIntMoreThan32Bits()
     QVariant v = convertPyObjectToQVariant(o);
     QVERIFY(v.toLongLong() == two_fortytwo);
 }
+
+void
+TestPyOtherSide::testCallSeesLaterImports()
+{
+    QPython14 py;
+
+    // The compiled expression for 'os.getcwd' is cached after the first call,
+    // but the name must still be resolved against globals on each call
+    QVERIFY(!py.call_sync("os.getcwd").isValid());
+    QVERIFY(py.importModule_sync("os"));
+    QVERIFY(!py.call_sync("os.getcwd").toString().isEmpty());
+}
+
+void
+TestPyOtherSide::benchmarkCallNoop()
+{
+    QPython14 py;
+
+    // Per-call overhead of call_sync() with a function name that has to be
+    // resolved from a string (the function itself does nothing)
+    QBENCHMARK {
+        py.call_sync("(lambda: None)");
+    }
+}
+
+void
+TestPyOtherSide::testBind()
+{
+    QPython14 py;
+    QJSEngine engine;
+
+    QObject *o = py.bind("(lambda a, b: a + b)");
+    QPythonCallable *add = qobject_cast<QPythonCallable *>(o);
+    QVERIFY(add != NULL);
+
+    QJSValue args = engine.toScriptValue(QVariantList() << 20 << 22);
+    QVERIFY(add->invokeSync(args).toInt() == 42);
+
+    // Binding something that is not callable fails right away
+    QVERIFY(py.bind("123") == NULL);
+
+    delete o;
+}
+
+void
+TestPyOtherSide::benchmarkBoundInvokeNoop()
+{
+    QPython14 py;
+    QJSEngine engine;
+
+    QObject *o = py.bind("(lambda: None)");
+    QPythonCallable *noop = qobject_cast<QPythonCallable *>(o);
+    QVERIFY(noop != NULL);
+
+    // Per-call overhead of a bound callable, compare to benchmarkCallNoop
+    QJSValue args = engine.newArray(0);
+    QBENCHMARK {
+        noop->invokeSync(args);
+    }
+
+    delete o;
+}
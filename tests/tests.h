@@ -40,6 +40,10 @@ class TestPyOtherSide : public QObject {
         void testConvertToPythonAndBack();
         void testSetToList();
         void testIntMoreThan32Bits();
+        void testCallSeesLaterImports();
+        void benchmarkCallNoop();
+        void testBind();
+        void benchmarkBoundInvokeNoop();
 };
 
 #endif /* PYOTHERSIDE_TESTS_H */